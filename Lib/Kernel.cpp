@@ -1,14 +1,18 @@
+#include "QPULib.h"
 #include "Source/Pretty.h"
 #include "Source/Translate.h"
 #include "Target/Pretty.h"
 #include "Target/Emulator.h"
 #include "Target/RemoveLabels.h"
+#include "Target/SimplifyCFG.h"
+#include "Target/Flags.h"
 #include "Target/CFG.h"
 #include "Target/Liveness.h"
 #include "Target/ReachingDefs.h"
 #include "Target/LiveRangeSplit.h"
 #include "Target/RegAlloc.h"
 #include "Target/Satisfy.h"
+#include "Target/Peephole.h"
 #include "Target/LoadStore.h"
 #include "Target/Encode.h"
 
@@ -28,6 +32,12 @@ void compileKernel(Seq<Instr>* targetCode, Stmt* body)
   // Translate to target code
   translateStmt(targetCode, body);
 
+  // Remove redundant branches and labels
+  simplifyCFG(targetCode);
+
+  // Remove redundant condition-flag updates
+  removeRedundantFlags(targetCode);
+
   // Load/store pass
   loadStorePass(targetCode);
 
@@ -44,6 +54,9 @@ void compileKernel(Seq<Instr>* targetCode, Stmt* body)
   // Satisfy target code constraints
   satisfy(targetCode);
 
+  // Peephole optimisations
+  peephole(targetCode);
+
   #ifdef DEBUG
     printf("Target code\n");
     printf("===========\n\n");
@@ -52,8 +65,51 @@ void compileKernel(Seq<Instr>* targetCode, Stmt* body)
       pretty(targetCode->elems[i]);
     }
     printf("\n");
+    printPeepholeHits();
+    printf("\n");
   #endif
 
   // Translate branch-to-labels to relative branches
   removeLabels(targetCode);
 }
+
+// ============================================================================
+// Compiled kernels
+// ============================================================================
+
+KernelCode::KernelCode(Stmt* body)
+{
+  // Save pointer to source program for interpreter
+  #ifdef EMULATION_MODE
+  sourceCode = body;
+  #else
+  sourceCode = NULL;
+  #endif
+
+  // Compile
+  compileKernel(&targetCode, body);
+
+  // Remember the number of variables used
+  numVars = getFreshVarCount();
+
+  #ifdef QPU_MODE
+  enableQPUs();
+
+  // Encode target instrs into array of 32-bit ints
+  Seq<uint32_t> code;
+  encode(&targetCode, &code);
+
+  // Copy kernel to code memory
+  qpuCodeMem = new SharedArray<uint32_t>(code.numElems);
+  for (int i = 0; i < code.numElems; i++)
+    (*qpuCodeMem)[i] = code.elems[i];
+  #endif
+}
+
+KernelCode::~KernelCode()
+{
+  #ifdef QPU_MODE
+  delete qpuCodeMem;
+  disableQPUs();
+  #endif
+}
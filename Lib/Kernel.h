@@ -5,8 +5,12 @@
 #include "Target/Emulator.h"
 #include "Target/Encode.h"
 #include "VideoCore/SharedArray.h"
+#include "VideoCore/WorkQueue.h"
+#include "VideoCore/RingBuffer.h"
 #include "VideoCore/Invoke.h"
 #include "VideoCore/VideoCore.h"
+#include <memory>
+#include <thread>
 
 // ============================================================================
 // Modes of operation
@@ -33,6 +37,8 @@
 //   * call(...)       in EMULATION_MODE, same as emulate(...)
 //                     in QPU_MODE, same as qpu(...)
 //                     in EMULATION_MODE *and* QPU_MODE, same as emulate(...)
+//   * start(...)      like call(...) but returns at once, leaving the
+//                     kernel running in the background until wait()
 
 // Notice it is OK to compile with both -D EMULATION_MODE *and*
 // -D QPU_MODE.  This feature is provided for doing equivalance
@@ -75,6 +81,18 @@ template <> inline Ptr<Float> mkArg< Ptr<Float> >() {
   return x;
 }
 
+template <> inline Ptr<Char4> mkArg< Ptr<Char4> >() {
+  Ptr<Char4> x;
+  x = getUniformPtr<Char4>();
+  return x;
+}
+
+template <> inline Ptr<Half> mkArg< Ptr<Half> >() {
+  Ptr<Half> x;
+  x = getUniformPtr<Half>();
+  return x;
+}
+
 // ============================================================================
 // Parameter passing
 // ============================================================================
@@ -135,6 +153,76 @@ template <> inline bool passParam< Ptr<Ptr<Float>>, SharedArray<float*>* >
   return true;
 }
 
+// Pass a SharedArray<uint8_t>*, four elements per word
+template <> inline bool passParam< Ptr<Int>, SharedArray<uint8_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<uint8_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+template <> inline bool passParam< Ptr<Char4>, SharedArray<uint8_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<uint8_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+// Pass a SharedArray<int16_t>*, two elements per word
+template <> inline bool passParam< Ptr<Int>, SharedArray<int16_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<int16_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+// Pass a SharedArray<uint16_t>* of half-precision floats, two per word
+template <> inline bool passParam< Ptr<Int>, SharedArray<uint16_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<uint16_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+template <> inline bool passParam< Ptr<Half>, SharedArray<uint16_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<uint16_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+// Pass a SharedArray<uint32_t>* holding packed 8-bit values
+template <> inline bool passParam< Ptr<Char4>, SharedArray<uint32_t>* >
+  (Seq<int32_t>* uniforms, SharedArray<uint32_t>* p)
+{
+  uniforms->append(p->getAddress());
+  return true;
+}
+
+// Pass a WorkQueue*
+template <> inline bool passParam< Ptr<Int>, WorkQueue* >
+  (Seq<int32_t>* uniforms, WorkQueue* q)
+{
+  uniforms->append(q->getAddress());
+  return true;
+}
+
+// Pass a RingBuffer<int>*
+template <> inline bool passParam< Ptr<Int>, RingBuffer<int>* >
+  (Seq<int32_t>* uniforms, RingBuffer<int>* r)
+{
+  uniforms->append(r->getAddress());
+  return true;
+}
+
+// Pass a RingBuffer<float>*
+template <> inline bool passParam< Ptr<Float>, RingBuffer<float>* >
+  (Seq<int32_t>* uniforms, RingBuffer<float>* r)
+{
+  uniforms->append(r->getAddress());
+  return true;
+}
+
 // ============================================================================
 // Functions on kernels
 // ============================================================================
@@ -142,6 +230,36 @@ template <> inline bool passParam< Ptr<Ptr<Float>>, SharedArray<float*>* >
 // Compile a kernel
 void compileKernel(Seq<Instr>* targetCode, Stmt* s);
 
+// The result of compiling a kernel.  It is not changed once built, and
+// is shared by a kernel and its clones, so that they share one copy of
+// the code in memory.
+
+struct KernelCode {
+  // AST representing the source code
+  Stmt* sourceCode;
+
+  // AST representing the target code
+  Seq<Instr> targetCode;
+
+  // The number of variables in the source code
+  int numVars;
+
+  // Memory region for QPU code
+  #ifdef QPU_MODE
+  SharedArray<uint32_t>* qpuCodeMem;
+  #endif
+
+  // Compile the given AST
+  KernelCode(Stmt* body);
+
+  ~KernelCode();
+
+ private:
+  // Disallow assignment & copying
+  void operator=(const KernelCode& c);
+  KernelCode(const KernelCode& c);
+};
+
 // ============================================================================
 // Kernels
 // ============================================================================
@@ -152,31 +270,31 @@ void compileKernel(Seq<Instr>* targetCode, Stmt* s);
 // The kernel constructor takes a function with parameters of QPU
 // types 'ts'.  It applies the function to constuct an AST.
 
-template <typename... ts> struct Kernel {
-  // AST representing the source code
-  Stmt* sourceCode;
+// Kernels can be moved but not copied.  'clone()' gives another
+// kernel sharing the same code, with its own parameters and number of
+// QPUs, e.g. for invoking the same code from several threads.
 
-  // AST representing the target code
-  Seq<Instr> targetCode;
+template <typename... ts> struct Kernel {
+  // Compiled code, shared with clones
+  std::shared_ptr<KernelCode> code;
 
-  // Parameters to be passed to kernel
+  // Parameters to be passed to kernel (set on each invocation)
   Seq<int32_t> uniforms;
 
-  // The number of variables in the source code
-  int numVars;
-
   // Number of QPUs to run on
   int numQPUs;
 
-  // Memory region for QPU code and parameters
+  // Thread running the kernel in the background, if any
+  std::thread* background;
+
+  // Memory region for parameters, allocated on first invocation
   #ifdef QPU_MODE
-  SharedArray<uint32_t>* qpuCodeMem;
-  int qpuCodeMemOffset;
+  SharedArray<uint32_t>* qpuParamMem;
   #endif
 
   // Construct kernel out of C++ function
-  Kernel(void (*f)(ts... params)) {
-    numQPUs = 1;
+  Kernel(void (*f)(ts... params)) : uniforms(MAX_KERNEL_PARAMS) {
+    init();
 
     // Initialise AST constructors
     #ifndef EMULATION_MODE
@@ -192,6 +310,7 @@ template <typename... ts> struct Kernel {
     Int qpuId, qpuCount, readStride, writeStride;
     qpuId = getUniformInt();
     qpuCount = getUniformInt();
+    kernelStart();
 
     // Construct the AST
     f(mkArg<ts>()...);
@@ -203,40 +322,40 @@ template <typename... ts> struct Kernel {
     Stmt* body = stmtStack.top();
     stmtStack.pop();
 
-    // Save pointer to source program for interpreter
-    #ifdef EMULATION_MODE
-    sourceCode = body;
-    #else
-    sourceCode = NULL;
-    #endif
-
     // Compile
-    compileKernel(&targetCode, body);
-
-    // Remember the number of variables used
-    numVars = getFreshVarCount();
+    code = std::shared_ptr<KernelCode>(new KernelCode(body));
+  }
 
+  // Move constructor (not allowed while started)
+  Kernel(Kernel<ts...>&& k) : code(std::move(k.code)),
+                              uniforms(MAX_KERNEL_PARAMS) {
+    assert(k.background == NULL);
+    init();
+    numQPUs = k.numQPUs;
     #ifdef QPU_MODE
-    enableQPUs();
-
-    // Allocate code mem
-    qpuCodeMem = new SharedArray<uint32_t>;
-
-    // Encode target instrs into array of 32-bit ints
-    Seq<uint32_t> code;
-    encode(&targetCode, &code);
-
-    // Allocate memory for QPU code and parameters
-    int numWords = code.numElems + 12*MAX_KERNEL_PARAMS + 12*2;
-    qpuCodeMem->alloc(numWords);
+    qpuParamMem   = k.qpuParamMem;
+    k.qpuParamMem = NULL;
+    #endif
+  }
 
-    // Copy kernel to code memory
-    int offset = 0;
-    for (int i = 0; i < code.numElems; i++) {
-      (*qpuCodeMem)[offset++] = code.elems[i];
-    }
-    qpuCodeMemOffset = offset;
+  // Move assignment (not allowed while either kernel is started)
+  Kernel<ts...>& operator=(Kernel<ts...>&& k) {
+    assert(background == NULL && k.background == NULL);
+    code    = std::move(k.code);
+    numQPUs = k.numQPUs;
+    #ifdef QPU_MODE
+    delete qpuParamMem;
+    qpuParamMem   = k.qpuParamMem;
+    k.qpuParamMem = NULL;
     #endif
+    return *this;
+  }
+
+  // Another kernel sharing this one's code
+  Kernel<ts...> clone() {
+    Kernel<ts...> k(code);
+    k.numQPUs = numQPUs;
+    return k;
   }
 
   #ifdef EMULATION_MODE
@@ -246,11 +365,11 @@ template <typename... ts> struct Kernel {
     nothing(passParam<ts, us>(&uniforms, args)...);
 
     emulate
-      ( numQPUs          // Number of QPUs active
-      , &targetCode      // Instruction sequence
-      , numVars          // Number of vars in source
-      , &uniforms        // Kernel parameters
-      , NULL             // Use stdout
+      ( numQPUs            // Number of QPUs active
+      , &code->targetCode  // Instruction sequence
+      , code->numVars      // Number of vars in source
+      , &uniforms          // Kernel parameters
+      , NULL               // Use stdout
       );
   }
   #endif
@@ -263,11 +382,11 @@ template <typename... ts> struct Kernel {
     nothing(passParam<ts, us>(&uniforms, args)...);
 
     interpreter
-      ( numQPUs          // Number of QPUs active
-      , sourceCode       // Source program
-      , numVars          // Number of vars in source
-      , &uniforms        // Kernel parameters
-      , NULL             // Use stdout
+      ( numQPUs            // Number of QPUs active
+      , code->sourceCode   // Source program
+      , code->numVars      // Number of vars in source
+      , &uniforms          // Kernel parameters
+      , NULL               // Use stdout
       );
   }
   #endif
@@ -280,9 +399,38 @@ template <typename... ts> struct Kernel {
     nothing(passParam<ts, us>(&uniforms, args)...);
 
     // Invoke kernel on QPUs
-    invoke(numQPUs, *qpuCodeMem, qpuCodeMemOffset, &uniforms);
+    invoke(numQPUs, *code->qpuCodeMem, paramMem(), &uniforms);
   }
   #endif
+
+  // Invoke the kernel on a background thread, e.g. a persistent
+  // kernel serving a 'WorkQueue'.  The kernel must not be invoked
+  // again, or moved, until 'wait()' has returned.
+  template <typename... us> void start(us... args) {
+    assert(background == NULL);
+
+    // Pass params, checking arguments types us against parameter types ts
+    uniforms.clear();
+    nothing(passParam<ts, us>(&uniforms, args)...);
+
+    background = new std::thread([this] {
+      #ifdef EMULATION_MODE
+        emulate(numQPUs, &code->targetCode, code->numVars, &uniforms, NULL);
+      #else
+        invoke(numQPUs, *code->qpuCodeMem, paramMem(), &uniforms,
+               QPU_PERSISTENT_TIMEOUT);
+      #endif
+    });
+  }
+
+  // Wait for a kernel invoked by 'start()' to finish
+  void wait() {
+    if (background != NULL) {
+      background->join();
+      delete background;
+      background = NULL;
+    }
+  }
  
   // Invoke the kernel
   template <typename... us> void call(us... args) {
@@ -307,11 +455,40 @@ template <typename... ts> struct Kernel {
 
   // Deconstructor
   ~Kernel() {
+    wait();
+    #ifdef QPU_MODE
+      delete qpuParamMem;
+    #endif
+  }
+
+ private:
+  // Disallow copying (use 'clone()' or move instead)
+  Kernel(const Kernel<ts...>& k);
+  void operator=(const Kernel<ts...>& k);
+
+  // Construct a kernel sharing the given code
+  Kernel(std::shared_ptr<KernelCode> c) : code(c),
+                                          uniforms(MAX_KERNEL_PARAMS) {
+    init();
+  }
+
+  void init() {
+    numQPUs    = 1;
+    background = NULL;
     #ifdef QPU_MODE
-      delete qpuCodeMem;
-      disableQPUs();
+    qpuParamMem = NULL;
     #endif
   }
+
+  // Memory for the parameters of each QPU and the launch messages
+  #ifdef QPU_MODE
+  SharedArray<uint32_t>& paramMem() {
+    if (qpuParamMem == NULL)
+      qpuParamMem = new SharedArray<uint32_t>(
+                      12*(MAX_KERNEL_PARAMS+2) + 12*2);
+    return *qpuParamMem;
+  }
+  #endif
 };
 
 // Initialiser
@@ -3,9 +3,12 @@
 
 #include "Source/Int.h"
 #include "Source/Float.h"
+#include "Source/Char4.h"
+#include "Source/Half.h"
 #include "Source/Ptr.h"
 #include "Source/Cond.h"
 #include "Source/Stmt.h"
+#include "Source/Shared.h"
 #include "Kernel.h"
 
 #endif
@@ -0,0 +1,106 @@
+#include "Source/Char4.h"
+#include "Source/Stmt.h"
+
+// ============================================================================
+// Type 'Char4Expr'
+// ============================================================================
+
+// Constructors
+
+Char4Expr::Char4Expr() { this->expr = NULL; }
+
+// Helper constructor
+
+inline Char4Expr mkChar4Expr(Expr* e) { Char4Expr x; x.expr = e; return x; }
+
+// ============================================================================
+// Type 'Char4'
+// ============================================================================
+
+// Constructors
+
+Char4::Char4() {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+}
+
+Char4::Char4(Char4Expr e) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, e.expr);
+}
+
+// Copy constructors
+
+Char4::Char4(Char4& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+Char4::Char4(const Char4& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+// Cast to a Char4Expr
+
+Char4::operator Char4Expr() { return mkChar4Expr(this->expr); }
+
+// Assignment
+
+Char4& Char4::operator=(Char4& rhs)
+  { assign(this->expr, rhs.expr); return rhs; }
+
+Char4Expr Char4::operator=(Char4Expr rhs)
+  { assign(this->expr, rhs.expr); return rhs; };
+
+// ============================================================================
+// Generic operations
+// ============================================================================
+
+inline Char4Expr mkChar4Apply(Char4Expr a, Op op, Char4Expr b)
+{
+  Expr* e = mkApply(a.expr, op, b.expr);
+  return mkChar4Expr(e);
+}
+
+// ============================================================================
+// Specific operations
+// ============================================================================
+
+// Saturating add
+Char4Expr operator+(Char4Expr a, Char4Expr b)
+  { return mkChar4Apply(a, mkOp(ADD, UINT8), b); }
+
+// Saturating subtract
+Char4Expr operator-(Char4Expr a, Char4Expr b)
+  { return mkChar4Apply(a, mkOp(SUB, UINT8), b); }
+
+// Multiply
+Char4Expr operator*(Char4Expr a, Char4Expr b)
+  { return mkChar4Apply(a, mkOp(MUL, UINT8), b); }
+
+// Min
+Char4Expr min(Char4Expr a, Char4Expr b)
+  { return mkChar4Apply(a, mkOp(MIN, UINT8), b); }
+
+// Max
+Char4Expr max(Char4Expr a, Char4Expr b)
+  { return mkChar4Apply(a, mkOp(MAX, UINT8), b); }
+
+// Vector rotation
+Char4Expr rotate(Char4Expr a, IntExpr b)
+{
+  Expr* e = mkApply(a.expr, mkOp(ROTATE, UINT8), b.expr);
+  return mkChar4Expr(e);
+}
+
+// Reinterpret an Int as a Char4
+Char4Expr toChar4(IntExpr a)
+  { return mkChar4Expr(a.expr); }
+
+// Reinterpret a Char4 as an Int
+IntExpr toInt(Char4Expr a)
+  { IntExpr x; x.expr = a.expr; return x; }
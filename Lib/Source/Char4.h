@@ -0,0 +1,68 @@
+// This module defines type 'Char4' for a vector of 16 x 32-bit words,
+// each holding four unsigned 8-bit values.
+
+#ifndef _SOURCE_CHAR4_H_
+#define _SOURCE_CHAR4_H_
+
+#include <assert.h>
+#include "Source/Syntax.h"
+#include "Source/Int.h"
+
+// ============================================================================
+// Types                   
+// ============================================================================
+
+// A 'Char4Expr' defines a packed 8-bit vector expression which can
+// only be used on the RHS of assignment statements.
+
+struct Char4Expr {
+  // Abstract syntax tree
+  Expr* expr;
+  // Constructors
+  Char4Expr();
+};
+
+// A 'Char4' defines a packed 8-bit vector variable which can be used
+// in both the LHS and RHS of an assignment.
+
+struct Char4 {
+  // Abstract syntax tree
+  Expr* expr;
+
+  // Constructors
+  Char4();
+  Char4(Char4Expr e);
+
+  // Copy constructors
+  Char4(Char4& x);
+  Char4(const Char4& x);
+
+  // Cast to a Char4Expr
+  operator Char4Expr();
+
+  // Assignment
+  Char4& operator=(Char4& rhs);
+  Char4Expr operator=(Char4Expr rhs);
+};
+
+// ============================================================================
+// Operations
+// ============================================================================
+
+// All operations act on each of the four bytes of a word separately.
+// Addition and subtraction saturate to [0, 255].  Multiplication
+// treats bytes as fractions of 255, so x * 255 is x, and rounds to
+// nearest.
+
+Char4Expr operator+(Char4Expr a, Char4Expr b);
+Char4Expr operator-(Char4Expr a, Char4Expr b);
+Char4Expr operator*(Char4Expr a, Char4Expr b);
+Char4Expr min(Char4Expr a, Char4Expr b);
+Char4Expr max(Char4Expr a, Char4Expr b);
+Char4Expr rotate(Char4Expr a, IntExpr b);
+
+// Reinterpret the bits of a word; the lowest byte is byte 0
+Char4Expr toChar4(IntExpr a);
+IntExpr toInt(Char4Expr a);
+
+#endif
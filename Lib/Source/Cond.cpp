@@ -0,0 +1,77 @@
+#include "Source/Cond.h"
+#include "Source/Stmt.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Append the statement 'where (b) lhs = x else lhs = y'
+static void whereAssign(BExpr* b, Expr* lhs, Expr* x, Expr* y)
+{
+  Stmt* s = mkWhere(b, mkAssign(lhs, x), y == NULL ? NULL : mkAssign(lhs, y));
+  stmtStack.replace(mkSeq(stmtStack.top(), s));
+}
+
+// Assign the lane mask of b to lhs, which b may read
+static void assignMask(Expr* lhs, BExpr* b)
+{
+  whereAssign(b, lhs, mkIntLit(-1), mkIntLit(0));
+}
+
+// ============================================================================
+// Type 'Bool'
+// ============================================================================
+
+// Constructors
+
+Bool::Bool() {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+}
+
+Bool::Bool(BoolExpr b) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assignMask(this->expr, b.bexpr);
+}
+
+// Copy constructors
+
+Bool::Bool(Bool& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+Bool::Bool(const Bool& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+// Cast to a BoolExpr
+
+Bool::operator BoolExpr()
+  { return BoolExpr(mkCmp(this->expr, mkCmpOp(NEQ, INT32), mkIntLit(0))); }
+
+// Assignment
+
+Bool& Bool::operator=(Bool& rhs)
+  { assign(this->expr, rhs.expr); return rhs; }
+
+BoolExpr Bool::operator=(BoolExpr rhs)
+  { assignMask(this->expr, rhs.bexpr); return rhs; }
+
+// ============================================================================
+// Selection
+// ============================================================================
+
+IntExpr select(BoolExpr c, IntExpr a, IntExpr b)
+{
+  IntExpr x; x.expr = mkSelect(c.bexpr, a.expr, b.expr); return x;
+}
+
+FloatExpr select(BoolExpr c, FloatExpr a, FloatExpr b)
+{
+  FloatExpr x; x.expr = mkSelect(c.bexpr, a.expr, b.expr); return x;
+}
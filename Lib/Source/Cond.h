@@ -26,6 +26,31 @@ struct BoolExpr
   //operator Cond();
 };
 
+// A 'Bool' defines a boolean vector variable, holding a lane mask: -1
+// in lanes where it is true and 0 where it is false.  It can be used
+// wherever a 'BoolExpr' can, at the cost of one comparison with zero.
+
+struct Bool
+{
+  // Abstract syntax tree
+  Expr* expr;
+
+  // Constructors
+  Bool();
+  Bool(BoolExpr b);
+
+  // Copy constructors
+  Bool(Bool& x);
+  Bool(const Bool& x);
+
+  // Cast to a BoolExpr
+  operator BoolExpr();
+
+  // Assignment
+  Bool& operator=(Bool& rhs);
+  BoolExpr operator=(BoolExpr rhs);
+};
+
 // ============================================================================
 // Generic 'Int' comparison
 // ============================================================================
@@ -103,4 +128,16 @@ inline Cond any(BoolExpr a)
 inline Cond all(BoolExpr a)
   { return Cond(mkAll(a.bexpr)); }
 
+// ============================================================================
+// Selection
+// ============================================================================
+
+// In each lane, 'a' where the condition holds and 'b' elsewhere.  Both
+// 'a' and 'b' are evaluated in every lane.  This is an expression, so
+// it is re-evaluated each time a loop condition containing it is, and
+// compiles to a pair of predicated moves.
+
+IntExpr select(BoolExpr c, IntExpr a, IntExpr b);
+FloatExpr select(BoolExpr c, FloatExpr a, FloatExpr b);
+
 #endif
@@ -106,3 +106,40 @@ FloatExpr min(FloatExpr a, FloatExpr b)
 // Max
 FloatExpr max(FloatExpr a, FloatExpr b)
   { return mkFloatApply(a, mkOp(MAX, FLOAT), b); }
+
+// Reductions
+FloatExpr reduceAdd(FloatExpr a)
+  { return mkFloatApply(a, mkOp(REDUCE_ADD, FLOAT), 0.0f); }
+
+FloatExpr reduceMin(FloatExpr a)
+  { return mkFloatApply(a, mkOp(REDUCE_MIN, FLOAT), 0.0f); }
+
+FloatExpr reduceMax(FloatExpr a)
+  { return mkFloatApply(a, mkOp(REDUCE_MAX, FLOAT), 0.0f); }
+
+// Reciprocal
+FloatExpr recip(FloatExpr a)
+  { return mkFloatApply(a, mkOp(RECIP, FLOAT), 0.0f); }
+
+// Reciprocal square root
+FloatExpr rsqrt(FloatExpr a)
+  { return mkFloatApply(a, mkOp(RECIPSQRT, FLOAT), 0.0f); }
+
+// Base-2 exponential
+FloatExpr exp2(FloatExpr a)
+  { return mkFloatApply(a, mkOp(EXP, FLOAT), 0.0f); }
+
+// Base-2 logarithm
+FloatExpr log2(FloatExpr a)
+  { return mkFloatApply(a, mkOp(LOG, FLOAT), 0.0f); }
+
+// Divide
+FloatExpr operator/(FloatExpr a, FloatExpr b)
+  { return mkFloatApply(a, mkOp(DIV, FLOAT), b); }
+
+FloatExpr div(FloatExpr a, FloatExpr b, Precision prec)
+  { return mkFloatApply(a, mkOp(DIV, FLOAT, prec), b); }
+
+// Square root
+FloatExpr sqrt(FloatExpr a, Precision prec)
+  { return mkFloatApply(a, mkOp(SQRT, FLOAT, prec), 0.0f); }
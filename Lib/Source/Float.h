@@ -57,4 +57,42 @@ FloatExpr operator*(FloatExpr a, FloatExpr b);
 FloatExpr min(FloatExpr a, FloatExpr b);
 FloatExpr max(FloatExpr a, FloatExpr b);
 
+// Reductions, giving the result in every lane
+FloatExpr reduceAdd(FloatExpr a);
+FloatExpr reduceMin(FloatExpr a);
+FloatExpr reduceMax(FloatExpr a);
+
+// Evaluated by the special function unit (SFU).  Each is a single
+// SFU estimate, good to around 22 bits on the QPU and exact in the
+// emulator, costing 4 instructions.
+FloatExpr recip(FloatExpr a);
+FloatExpr rsqrt(FloatExpr a);
+FloatExpr exp2(FloatExpr a);
+FloatExpr log2(FloatExpr a);
+
+// Division and square root start from an SFU estimate and apply a
+// number of Newton-Raphson steps, each of which roughly doubles the
+// number of correct bits until float rounding dominates:
+//
+//   Precision   Steps   Cost of a / b   Cost of sqrt(a)
+//   Approx      0       5 instrs        12 instrs
+//   Refined     1       8 instrs        18 instrs
+//   Precise     2       11 instrs       23 instrs
+//
+// Approx is only as accurate as the SFU estimate, around 22 bits;
+// Refined reaches full float precision from an estimate good to 12
+// bits, and Precise from one good to 6 bits.  Operator '/' uses Refined.  The emulator's
+// SFU is exact, so all modes agree there; the interpreter gives the
+// IEEE results.  As in C, sqrt(a) is NaN for a below zero, and -0 for
+// -0.  It is only defined for finite a, and as the QPU flushes
+// denormals to zero, for a zero or at least FLT_MIN in magnitude.
+
+const Precision Approx  = PREC_APPROX;
+const Precision Refined = PREC_REFINED;
+const Precision Precise = PREC_PRECISE;
+
+FloatExpr operator/(FloatExpr a, FloatExpr b);
+FloatExpr div(FloatExpr a, FloatExpr b, Precision prec);
+FloatExpr sqrt(FloatExpr a, Precision prec = PREC_REFINED);
+
 #endif
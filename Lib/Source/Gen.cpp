@@ -105,6 +105,14 @@ Op genOp(GenOptions* opts, Type t)
     case PTR2_TYPE:
       op.type = INT32;
       op.op   = (OpId) randRange(opts->genRotate ? ROTATE : ADD, BNOT);
+      // Sometimes generate division or modulo
+      if (t.tag == INT_TYPE && opts->genDiv && randRange(0, 9) == 0)
+        op.op = randRange(0, 1) == 0 ? DIV : MOD;
+      // Sometimes generate a packed 8-bit operation
+      else if (t.tag == INT_TYPE && opts->genChar4 && randRange(0, 9) == 0) {
+        op.type = UINT8;
+        op.op   = (OpId) randRange(ADD, MAX);
+      }
       return op;
 
     case FLOAT_TYPE:
@@ -121,6 +129,9 @@ Op genOp(GenOptions* opts, Type t)
 // Random arithmetic expressions
 // ============================================================================
 
+// Selections contain boolean expressions
+BExpr* genBExpr(GenOptions* opts, int depth);
+
 Expr* genExpr(GenOptions* opts, Type t, int depth)
 {
   switch (randRange(0, 3)) { 
@@ -184,6 +195,35 @@ Expr* genExpr(GenOptions* opts, Type t, int depth)
             return mkApply(e, op, mkIntLit(0));
           }
         }
+        // Sometimes generate a special function unit operation.  The
+        // operand is clamped to [1, 16] so that the result is finite:
+        // comparisons with NaN differ between the QPU and the interpreter.
+        if (t.tag == FLOAT_TYPE && opts->genSFU && randRange(0, 9) == 0) {
+          Op op = mkOp((OpId) randRange(RECIP, LOG), FLOAT);
+          Expr* e = genExpr(opts, t, depth-1);
+          e = mkApply(e, mkOp(MAX, FLOAT), mkFloatLit(1));
+          e = mkApply(e, mkOp(MIN, FLOAT), mkFloatLit(16));
+          return mkApply(e, op, mkFloatLit(0));
+        }
+        // Sometimes generate a reduction across lanes
+        if (opts->genReduce && randRange(0, 9) == 0) {
+          if (t.tag == INT_TYPE) {
+            Op op = mkOp((OpId) randRange(REDUCE_ADD, REDUCE_OR), INT32);
+            return mkApply(genExpr(opts, t, depth-1), op, mkIntLit(0));
+          }
+          else if (t.tag == FLOAT_TYPE) {
+            Op op = mkOp((OpId) randRange(REDUCE_ADD, REDUCE_MAX), FLOAT);
+            return mkApply(genExpr(opts, t, depth-1), op, mkFloatLit(0));
+          }
+        }
+        // Sometimes generate a selection
+        if ((t.tag == INT_TYPE || t.tag == FLOAT_TYPE) &&
+            opts->genSelect && randRange(0, 9) == 0) {
+          BExpr* cond = genBExpr(opts, depth-1);
+          Expr* e1 = genExpr(opts, t, depth-1);
+          Expr* e2 = genExpr(opts, t, depth-1);
+          return mkSelect(cond, e1, e2);
+        }
         // Otherwise, generate random operator application
         Expr* e1 = genExpr(opts, t, depth-1);
         Expr* e2 = genExpr(opts, t, depth-1);
@@ -330,6 +370,15 @@ Stmt* genAssign(GenOptions* opts, int depth)
 // Random conditional assignments
 // ============================================================================
 
+// Sometimes override the compiler's choice of whether to branch over
+// the body of a where statement
+Stmt* genHint(GenOptions* opts, Stmt* s)
+{
+  if (opts->genWhereHint)
+    s->where.hint = (WhereHint) randRange(WHERE_AUTO, WHERE_PREDICATED);
+  return s;
+}
+
 Stmt* genWhere(GenOptions* opts, int depth, int length)
 {
   switch (randRange(0, 3)) {
@@ -342,9 +391,9 @@ Stmt* genWhere(GenOptions* opts, int depth, int length)
     // Nested where
     case 1:
       if (depth > 0)
-        return mkWhere(genBExpr(opts, depth),
-                       genWhere(opts, depth-1, opts->length),
-                       genWhere(opts, depth-1, opts->length));
+        return genHint(opts, mkWhere(genBExpr(opts, depth),
+                         genWhere(opts, depth-1, opts->length),
+                         genWhere(opts, depth-1, opts->length)));
 
     // Skip
     case 2:
@@ -425,9 +474,9 @@ Stmt* genStmt(GenOptions* opts, int depth, int length)
     // Where statement
     case WHERE:
       if (length > 0 && depth > 0)
-        return mkWhere(genBExpr(opts, depth),
-                       genWhere(opts, depth-1, opts->length),
-                       genWhere(opts, depth-1, opts->length));
+        return genHint(opts, mkWhere(genBExpr(opts, depth),
+                         genWhere(opts, depth-1, opts->length),
+                         genWhere(opts, depth-1, opts->length)));
 
     // If statement
     case IF:
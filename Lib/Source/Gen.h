@@ -33,6 +33,21 @@ struct GenOptions {
   // Generate rotate operations?
   bool genRotate;
 
+  // Generate special function unit operations (requires genFloat)?
+  bool genSFU;
+
+  // Generate integer division and modulo?
+  bool genDiv;
+
+  // Generate reductions across lanes?
+  bool genReduce;
+
+  // Generate packed 8-bit operations on integers?
+  bool genChar4;
+
+  // Generate selections between two expressions?
+  bool genSelect;
+
   // Generate pointer-dereferencing operations?
   bool genDeref;
   bool genDeref2;
@@ -44,6 +59,9 @@ struct GenOptions {
 
   // Allow loads and stores to be strided?
   bool genStrided;
+
+  // Generate hints on whether to branch over where statements?
+  bool genWhereHint;
 };
 
 // Generate random literals
@@ -0,0 +1,76 @@
+#include "Source/Half.h"
+
+// ============================================================================
+// Type 'HalfExpr'
+// ============================================================================
+
+// Constructors
+
+HalfExpr::HalfExpr() { this->expr = NULL; }
+
+// Helper constructor
+
+inline HalfExpr mkHalfExpr(Expr* e) { HalfExpr x; x.expr = e; return x; }
+
+// ============================================================================
+// Type 'Half'
+// ============================================================================
+
+// Constructors
+
+Half::Half() {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+}
+
+Half::Half(HalfExpr e) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, e.expr);
+}
+
+// Copy constructors
+
+Half::Half(Half& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+Half::Half(const Half& x) {
+  Var v    = freshVar();
+  this->expr = mkVar(v);
+  assign(this->expr, x.expr);
+}
+
+// Cast to a HalfExpr
+
+Half::operator HalfExpr() { return mkHalfExpr(this->expr); }
+
+// Assignment
+
+Half& Half::operator=(Half& rhs)
+  { assign(this->expr, rhs.expr); return rhs; }
+
+HalfExpr Half::operator=(HalfExpr rhs)
+  { assign(this->expr, rhs.expr); return rhs; };
+
+// ============================================================================
+// Specific operations
+// ============================================================================
+
+// Widen half k to a float
+FloatExpr toFloat(HalfExpr a, int k)
+  { return unpackHalfFloat(toInt(a), k); }
+
+// Round two floats to halves
+HalfExpr toHalf(FloatExpr a, FloatExpr b)
+  { return toHalf(packHalfFloat(a, b)); }
+
+// Reinterpret an Int as a Half
+HalfExpr toHalf(IntExpr a)
+  { return mkHalfExpr(a.expr); }
+
+// Reinterpret a Half as an Int
+IntExpr toInt(HalfExpr a)
+  { IntExpr x; x.expr = a.expr; return x; }
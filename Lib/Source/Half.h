@@ -0,0 +1,86 @@
+// This module defines type 'Half' for a vector of 16 x 32-bit words,
+// each holding two half-precision floats.
+
+#ifndef _SOURCE_HALF_H_
+#define _SOURCE_HALF_H_
+
+#include <assert.h>
+#include "Source/Syntax.h"
+#include "Source/Int.h"
+#include "Source/Float.h"
+#include "Source/Stmt.h"
+
+// ============================================================================
+// Types                   
+// ============================================================================
+
+// A 'HalfExpr' defines a packed half-precision vector expression which
+// can only be used on the RHS of assignment statements.
+
+struct HalfExpr {
+  // Abstract syntax tree
+  Expr* expr;
+  // Constructors
+  HalfExpr();
+};
+
+// A 'Half' defines a packed half-precision vector variable which can
+// be used in both the LHS and RHS of an assignment.
+
+struct Half {
+  // Abstract syntax tree
+  Expr* expr;
+
+  // Constructors
+  Half();
+  Half(HalfExpr e);
+
+  // Copy constructors
+  Half(Half& x);
+  Half(const Half& x);
+
+  // Cast to a HalfExpr
+  operator HalfExpr();
+
+  // Assignment
+  Half& operator=(Half& rhs);
+  HalfExpr operator=(HalfExpr rhs);
+};
+
+// ============================================================================
+// Operations
+// ============================================================================
+
+// Widen half k (0..1) of each word to a float, exactly, using the
+// float16 unpack mode of register file A
+FloatExpr toFloat(HalfExpr a, int k);
+
+// Round a and b to half precision, to nearest even, giving halves 0
+// and 1 of each word
+HalfExpr toHalf(FloatExpr a, FloatExpr b);
+
+// Reinterpret the bits of a word; the lower half is half 0
+HalfExpr toHalf(IntExpr a);
+IntExpr toInt(HalfExpr a);
+
+// ============================================================================
+// Loads and stores
+// ============================================================================
+
+// A 'Ptr<Half>' kernel parameter is passed a 'SharedArray<uint16_t>',
+// whose elements 2i and 2i+1 are halves 0 and 1 of word i.  Halves
+// are read and written a word at a time, e.g.
+//
+//   Half h = *p;
+//   *q = toHalf(toFloat(h, 0) * 2, toFloat(h, 1) * 2);
+
+inline void receive(Half& dest)
+  { receiveExpr(dest.expr); }
+
+inline void store(HalfExpr data, PtrExpr<Half> addr)
+  { storeExpr(data.expr, addr.expr); }
+
+inline void store(HalfExpr data, Ptr<Half> &addr)
+  { storeExpr(data.expr, addr.expr); }
+
+#endif
@@ -130,6 +130,80 @@ FloatExpr rotate(FloatExpr a, IntExpr b)
   return mkFloatExpr(e);
 }
 
+// Every lane takes the value of the given lane of a
+IntExpr broadcast(IntExpr a, IntExpr lane)
+{
+  // Clear every other lane, then combine all lanes
+  return reduceOr(a & (((index() ^ lane) - 1) >> 31));
+}
+
+FloatExpr broadcast(FloatExpr a, IntExpr lane)
+{
+  return mkFloatExpr(broadcast(mkIntExpr(a.expr), lane).expr);
+}
+
+// Lane 0 takes the value of the given lane of a
+IntExpr extract(IntExpr a, IntExpr lane)
+{
+  if (lane.expr->tag == INT_LIT) {
+    int n = (16 - lane.expr->intLit) & 15;
+    return n == 0 ? a : rotate(a, n);
+  }
+  return rotate(a, 16 - lane);
+}
+
+FloatExpr extract(FloatExpr a, IntExpr lane)
+{
+  return mkFloatExpr(extract(mkIntExpr(a.expr), lane).expr);
+}
+
+// Lane i takes the value of lane pattern[i] of a
+IntExpr permute(IntExpr a, const int* pattern)
+{
+  // The set of lanes needing each rotation amount
+  int lanes[16] = {0};
+  for (int i = 0; i < 16; i++) {
+    assert(pattern[i] >= 0 && pattern[i] < 16);
+    lanes[(i - pattern[i] + 16) % 16] |= 1 << i;
+  }
+
+  // Rotate once per distinct amount, masking out the lanes that need
+  // a different amount.  The mask for a set of lanes s is formed by
+  // shifting bit i of s to the top and sign-extending.  The result is
+  // a pure expression, rather than using temporaries, so that it reads
+  // every lane of a even inside 'Where'.
+  IntExpr result;
+  for (int n = 0; n < 16; n++) {
+    if (lanes[n] == 0) continue;
+    IntExpr y = n == 0 ? a : rotate(a, n);
+    if (lanes[n] != 0xffff)
+      y = y & ((IntExpr(lanes[n]) << (31 - index())) >> 31);
+    result = result.expr == NULL ? y : result | y;
+  }
+  return result;
+}
+
+FloatExpr permute(FloatExpr a, const int* pattern)
+{
+  return mkFloatExpr(permute(mkIntExpr(a.expr), pattern).expr);
+}
+
+// Reductions, giving the result in every lane
+IntExpr reduceAdd(IntExpr a)
+  { return mkIntApply(a, mkOp(REDUCE_ADD, INT32), 0); }
+
+IntExpr reduceMin(IntExpr a)
+  { return mkIntApply(a, mkOp(REDUCE_MIN, INT32), 0); }
+
+IntExpr reduceMax(IntExpr a)
+  { return mkIntApply(a, mkOp(REDUCE_MAX, INT32), 0); }
+
+IntExpr reduceAnd(IntExpr a)
+  { return mkIntApply(a, mkOp(REDUCE_AND, INT32), 0); }
+
+IntExpr reduceOr(IntExpr a)
+  { return mkIntApply(a, mkOp(REDUCE_OR, INT32), 0); }
+
 // Add
 IntExpr operator+(IntExpr a, IntExpr b)
   { return mkIntApply(a, mkOp(ADD, INT32), b); }
@@ -146,6 +220,14 @@ IntExpr operator-(IntExpr a, IntExpr b)
 IntExpr operator*(IntExpr a, IntExpr b)
   { return mkIntApply(a, mkOp(MUL, INT32), b); }
 
+// Divide
+IntExpr operator/(IntExpr a, IntExpr b)
+  { return mkIntApply(a, mkOp(DIV, INT32), b); }
+
+// Modulo
+IntExpr operator%(IntExpr a, IntExpr b)
+  { return mkIntApply(a, mkOp(MOD, INT32), b); }
+
 // Min
 IntExpr min(IntExpr a, IntExpr b)
   { return mkIntApply(a, mkOp(MIN, INT32), b); }
@@ -199,3 +281,45 @@ FloatExpr toFloat(IntExpr a)
   Expr* e = mkApply(a.expr, mkOp(ItoF, FLOAT), mkIntLit(0));
   return mkFloatExpr(e);
 }
+
+// Byte k (0..3) of each word, zero-extended
+IntExpr unpackByte(IntExpr a, int k)
+{
+  assert(k >= 0 && k < 4);
+  return mkIntApply(a, mkOp(UNPACK, UINT8), k);
+}
+
+// Half-word k (0..1) of each word, sign-extended
+IntExpr unpackHalf(IntExpr a, int k)
+{
+  assert(k >= 0 && k < 2);
+  return mkIntApply(a, mkOp(UNPACK, INT16), k);
+}
+
+// Pack the low bytes of a, b, c and d into bytes 0..3 of each word
+IntExpr packByte(IntExpr a, IntExpr b, IntExpr c, IntExpr d)
+{
+  return packHalf(mkIntApply(a, mkOp(PACK, UINT8), b),
+                  mkIntApply(c, mkOp(PACK, UINT8), d));
+}
+
+// Pack the low half-words of a and b into half-words 0..1 of each word
+IntExpr packHalf(IntExpr a, IntExpr b)
+{
+  return mkIntApply(a, mkOp(PACK, INT16), b);
+}
+
+// Half-word k (0..1) of each word, read as a half-precision float
+FloatExpr unpackHalfFloat(IntExpr a, int k)
+{
+  assert(k >= 0 && k < 2);
+  Expr* e = mkApply(a.expr, mkOp(UNPACK, FLOAT), mkIntLit(k));
+  return mkFloatExpr(e);
+}
+
+// Pack a and b as half-precision floats into half-words 0..1 of each word
+IntExpr packHalfFloat(FloatExpr a, FloatExpr b)
+{
+  Expr* e = mkApply(a.expr, mkOp(PACK, FLOAT), b.expr);
+  return mkIntExpr(e);
+}
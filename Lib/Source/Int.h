@@ -61,9 +61,23 @@ IntExpr numQPUs();
 IntExpr rotate(IntExpr a, IntExpr b);
 FloatExpr rotate(FloatExpr a, IntExpr b);
 
+// Cross-lane operations.  The lane must be the same in every lane of
+// its argument.  A permutation takes lane pattern[i] of a to lane i,
+// for a pattern of 16 lane numbers fixed at compile time; it costs one
+// rotate per distinct distance moved, each re-evaluating a, so a is
+// best a variable.
+IntExpr broadcast(IntExpr a, IntExpr lane);
+FloatExpr broadcast(FloatExpr a, IntExpr lane);
+IntExpr extract(IntExpr a, IntExpr lane);
+FloatExpr extract(FloatExpr a, IntExpr lane);
+IntExpr permute(IntExpr a, const int* pattern);
+FloatExpr permute(FloatExpr a, const int* pattern);
+
 IntExpr operator+(IntExpr a, IntExpr b);
 IntExpr operator-(IntExpr a, IntExpr b);
 IntExpr operator*(IntExpr a, IntExpr b);
+IntExpr operator/(IntExpr a, IntExpr b);
+IntExpr operator%(IntExpr a, IntExpr b);
 IntExpr min(IntExpr a, IntExpr b);
 IntExpr max(IntExpr a, IntExpr b);
 IntExpr operator<<(IntExpr a, IntExpr b);
@@ -72,9 +86,39 @@ IntExpr operator&(IntExpr a, IntExpr b);
 IntExpr operator|(IntExpr a, IntExpr b);
 IntExpr operator^(IntExpr a, IntExpr b);
 IntExpr operator~(IntExpr a);
+IntExpr reduceAdd(IntExpr a);
+IntExpr reduceMin(IntExpr a);
+IntExpr reduceMax(IntExpr a);
+IntExpr reduceAnd(IntExpr a);
+IntExpr reduceOr(IntExpr a);
 IntExpr shr(IntExpr a, IntExpr b);
 IntExpr ror(IntExpr a, IntExpr b);
 IntExpr toInt(FloatExpr a);
 FloatExpr toFloat(IntExpr a);
 
+// Sub-word access.  Memory holding 8-bit or 16-bit elements is read
+// and written a word at a time, four bytes or two half-words per
+// lane.  Bytes are zero-extended and half-words sign-extended; packing
+// truncates each value to its low bits.  These compile to moves using
+// the unpack and pack modes of register file A: an unpack costs one
+// instruction, packHalf two and packByte four.
+
+IntExpr unpackByte(IntExpr a, int k);
+IntExpr unpackHalf(IntExpr a, int k);
+IntExpr packByte(IntExpr a, IntExpr b, IntExpr c, IntExpr d);
+IntExpr packHalf(IntExpr a, IntExpr b);
+
+// Half-precision floats, stored two per word (see also type 'Half').
+// Unpacking is exact, using the float16 unpack mode of register file
+// A.  Packing rounds to nearest even, overflowing to infinity, with
+// NaNs becoming quiet NaNs; it takes about twenty instructions a value.
+
+FloatExpr unpackHalfFloat(IntExpr a, int k);
+IntExpr packHalfFloat(FloatExpr a, FloatExpr b);
+
+// Division and modulo round towards zero, as in C.  Division by a
+// literal compiles to multiplies and shifts, and division by a
+// variable to a 32-step loop, which inside 'where' runs in every lane.
+// The result of division by zero is unspecified.
+
 #endif
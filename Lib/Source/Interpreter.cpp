@@ -1,3 +1,5 @@
+#include <math.h>
+#include <string.h>
 #include "Source/Interpreter.h"
 #include "Target/Emulator.h"
 
@@ -62,6 +64,72 @@ inline int32_t rotRight(int32_t x, int32_t n)
   return (ux >> n) | (x << (32-n));
 }
 
+// Integer division and modulo, rounding towards zero.  Division by
+// zero gives what the compiled code gives for all dividends other
+// than INT_MIN: a quotient of 1 or -1 and a remainder equal to the
+// dividend.
+inline int32_t divide(int32_t x, int32_t y, bool mod)
+{
+  if (y == 0) return mod ? x : (x < 0 ? 1 : -1);
+  if (y == -1) return mod ? 0 : (int32_t) (0 - (uint32_t) x);
+  return mod ? x % y : x / y;
+}
+
+// Round a float to half precision, to nearest even, giving the same
+// bits as the compiled code (see 'roundHalf' in 'Source/Translate.cpp'):
+// NaNs become quiet NaNs without payload.
+inline int32_t roundHalf(float f)
+{
+  uint32_t bits;
+  memcpy(&bits, &f, 4);
+  uint32_t a = bits & 0x7fffffff;
+  uint32_t h;
+  if (a < 0x38800000) {
+    float x;
+    memcpy(&x, &a, 4);
+    x += 0.5f;
+    memcpy(&h, &x, 4);
+    h -= 0x3f000000;
+  }
+  else if (a > 0x7f800000) h = 0x7e00;
+  else if (a > 0x477fffff) h = 0x7c00;
+  else h = (a - 0x37fff001 + ((a >> 13) & 1)) >> 13;
+  return h | ((bits >> 16) & 0x8000);
+}
+
+// Apply a lane-wise reduction operator to two vectors
+inline Vec combine(Op op, Vec a, Vec b)
+{
+  Vec v;
+  for (int i = 0; i < NUM_LANES; i++) {
+    if (op.type == FLOAT) {
+      float x = a.elems[i].floatVal;
+      float y = b.elems[i].floatVal;
+      switch (op.op) {
+        case ADD: v.elems[i].floatVal = x+y; break;
+        case MIN: v.elems[i].floatVal = x<y?x:y; break;
+        case MAX: v.elems[i].floatVal = x>y?x:y; break;
+        default:  assert(false);
+      }
+    }
+    else {
+      int32_t x = a.elems[i].intVal;
+      int32_t y = b.elems[i].intVal;
+      switch (op.op) {
+        case ADD:  v.elems[i].intVal = x+y; break;
+        case MIN:  v.elems[i].intVal = x<y?x:y; break;
+        case MAX:  v.elems[i].intVal = x>y?x:y; break;
+        case BAND: v.elems[i].intVal = x&y; break;
+        case BOR:  v.elems[i].intVal = x|y; break;
+        default:   assert(false);
+      }
+    }
+  }
+  return v;
+}
+
+Vec evalBool(CoreState* s, BExpr* e);
+
 Vec eval(CoreState* s, Expr* e)
 {
   Vec v;
@@ -90,6 +158,48 @@ Vec eval(CoreState* s, Expr* e)
         // Vector rotation
         v = rotate(a, b.elems[0].intVal);
       }
+      else if (isReduce(e->apply.op)) {
+        // Reduction, combining lanes in the same order as the
+        // compiled code
+        v = a;
+        for (int n = NUM_LANES/2; n >= 1; n /= 2)
+          v = combine(reduceOp(e->apply.op), v, rotate(v, n));
+      }
+      else if (e->apply.op.op == UNPACK || e->apply.op.op == PACK) {
+        // Sub-word operation
+        int bits = e->apply.op.type == UINT8 ? 8 : 16;
+        for (int i = 0; i < NUM_LANES; i++) {
+          int32_t x = a.elems[i].intVal;
+          int32_t y = b.elems[i].intVal;
+          if (e->apply.op.type == FLOAT) {
+            if (e->apply.op.op == PACK)
+              v.elems[i].intVal = packSubWord(B16,
+                roundHalf(a.elems[i].floatVal),
+                roundHalf(b.elems[i].floatVal));
+            else
+              v.elems[i].floatVal = unpackHalfFloat(subWord(16, y), x);
+          }
+          else if (e->apply.op.op == PACK)
+            v.elems[i].intVal = packSubWord(subWord(bits, 1), x, y);
+          else
+            v.elems[i].intVal = unpackSubWord(subWord(bits, y), x);
+        }
+      }
+      else if (e->apply.op.type == UINT8) {
+        // Packed 8-bit operation
+        ALUOp op;
+        switch (e->apply.op.op) {
+          case ADD: op = A_V8ADDS; break;
+          case SUB: op = A_V8SUBS; break;
+          case MUL: op = M_V8MUL;  break;
+          case MIN: op = M_V8MIN;  break;
+          case MAX: op = M_V8MAX;  break;
+          default:  assert(false);
+        }
+        for (int i = 0; i < NUM_LANES; i++)
+          v.elems[i].intVal = v8Apply(op, a.elems[i].intVal,
+                                          b.elems[i].intVal);
+      }
       else if (e->apply.op.type == FLOAT) {
         // Floating-point operation
         for (int i = 0; i < NUM_LANES; i++) {
@@ -103,6 +213,12 @@ Vec eval(CoreState* s, Expr* e)
             case FtoI: v.elems[i].intVal   = (int) a.elems[i].floatVal; break;
             case MIN:  v.elems[i].floatVal = x<y?x:y; break;
             case MAX:  v.elems[i].floatVal = x>y?x:y; break;
+            case RECIP:     v.elems[i].floatVal = 1.0f/x; break;
+            case RECIPSQRT: v.elems[i].floatVal = 1.0f/sqrtf(x); break;
+            case EXP:       v.elems[i].floatVal = exp2f(x); break;
+            case LOG:       v.elems[i].floatVal = log2f(x); break;
+            case DIV:       v.elems[i].floatVal = x/y; break;
+            case SQRT:      v.elems[i].floatVal = sqrtf(x); break;
             default: assert(false);
           }
         }
@@ -128,6 +244,8 @@ Vec eval(CoreState* s, Expr* e)
             case BAND: v.elems[i].intVal = x&y; break;
             case BXOR: v.elems[i].intVal = x^y; break;
             case BNOT: v.elems[i].intVal = ~x; break;
+            case DIV:  v.elems[i].intVal = divide(x, y, false); break;
+            case MOD:  v.elems[i].intVal = divide(x, y, true); break;
             case ROR: v.elems[i].intVal = rotRight(x, y);
             default: assert(false);
           }
@@ -136,6 +254,16 @@ Vec eval(CoreState* s, Expr* e)
       return v;
     }
 
+    // Selection
+    case SELECT: {
+      Vec c = evalBool(s, e->select.cond);
+      Vec a = eval(s, e->select.lhs);
+      Vec b = eval(s, e->select.rhs);
+      for (int i = 0; i < NUM_LANES; i++)
+        v.elems[i] = c.elems[i].intVal ? a.elems[i] : b.elems[i];
+      return v;
+    }
+
     // Dereference pointer
     case DEREF:
       Vec a = eval(s, e->deref.ptr);
@@ -456,16 +584,94 @@ void execLoadReceive(CoreState* s, Expr* e)
   assignToVar(s, vecAlways(), e->var, val);
 }
 
-void execStoreRequest(CoreState* s, Expr* data, Expr* addr) {
-  Vec val = eval(s, data);
+void execLoadPartial(CoreState* s, Expr* dest, Expr* addr, Expr* count)
+{
+  assert(dest->tag == VAR);
   Vec index = eval(s, addr);
+  int n = eval(s, count).elems[0].intVal;
+  assert(n > 0 && n <= NUM_LANES);
   int hp = index.elems[0].intVal;
+  Vec val;
   for (int i = 0; i < NUM_LANES; i++) {
+    val.elems[i].intVal = i < n ? emuHeap[hp>>2] : 0;
+    hp += 4*(s->readStride+1);
+  }
+  assignToVar(s, vecAlways(), dest->var, val);
+}
+
+void execStoreRequest(CoreState* s, Expr* data, Expr* addr, Expr* count) {
+  Vec val = eval(s, data);
+  Vec index = eval(s, addr);
+  int n = count == NULL ? NUM_LANES : eval(s, count).elems[0].intVal;
+  assert(n > 0 && n <= NUM_LANES);
+  int hp = index.elems[0].intVal;
+  for (int i = 0; i < n; i++) {
     emuHeap[hp>>2] = val.elems[i].intVal;
     hp += 4*(s->writeStride+1);
   }
 }
 
+// ============================================================================
+// Execute scatter
+// ============================================================================
+
+void execScatter(CoreState* s, Expr* data, Expr* addr) {
+  Vec val = eval(s, data);
+  Vec index = eval(s, addr);
+  for (int i = 0; i < NUM_LANES; i++) {
+    uint32_t hp = (uint32_t) index.elems[i].intVal;
+    emuHeap[hp>>2] = val.elems[i].intVal;
+  }
+}
+
+// ============================================================================
+// Execute shared access
+// ============================================================================
+
+// Vector k of the scratchpad is held at word 16*k of the VPM.
+
+void execShared(InterpreterState* state, CoreState* s, Stmt* stmt)
+{
+  int k = eval(s, stmt->shared.index).elems[0].intVal;
+  int n = stmt->shared.count;
+  int i = k - stmt->shared.base;
+  if (i < 0 || i + n > stmt->shared.size) {
+    printf("QPULib: 'Shared' access to vectors %d to %d of an array of "
+           "%d vectors\n", i, i+n-1, stmt->shared.size);
+    assert(false);
+  }
+  assert(k >= 0 && (k+n)*NUM_LANES <= VPM_SIZE);
+  Word* vpm = &state->vpm[k*NUM_LANES];
+
+  switch (stmt->shared.op) {
+    case SHARED_READ: {
+      assert(stmt->shared.data->tag == VAR);
+      Vec val;
+      for (int i = 0; i < NUM_LANES; i++)
+        val.elems[i] = vpm[i];
+      assignToVar(s, vecAlways(), stmt->shared.data->var, val);
+      return;
+    }
+    case SHARED_WRITE: {
+      Vec val = eval(s, stmt->shared.data);
+      for (int i = 0; i < NUM_LANES; i++)
+        vpm[i] = val.elems[i];
+      return;
+    }
+    case SHARED_LOAD:
+    case SHARED_STORE: {
+      uint32_t hp = (uint32_t) eval(s, stmt->shared.addr).elems[0].intVal;
+      for (int i = 0; i < n*NUM_LANES; i++, hp += 4) {
+        if (stmt->shared.op == SHARED_LOAD)
+          vpm[i].intVal = emuHeap[hp>>2];
+        else
+          emuHeap[hp>>2] = vpm[i].intVal;
+      }
+      return;
+    }
+  }
+}
+
 // ============================================================================
 // Execute code
 // ============================================================================
@@ -542,7 +748,24 @@ void exec(InterpreterState* state, CoreState* s)
 
     // Store request
     case STORE_REQUEST:
-      execStoreRequest(s, stmt->storeReq.data, stmt->storeReq.addr);
+      execStoreRequest(s, stmt->storeReq.data, stmt->storeReq.addr,
+                       stmt->storeReq.count);
+      return;
+
+    // Partial load
+    case LOAD_PARTIAL:
+      execLoadPartial(s, stmt->loadReq.dest, stmt->loadReq.addr,
+                      stmt->loadReq.count);
+      return;
+
+    // Shared access
+    case SHARED:
+      execShared(state, s, stmt);
+      return;
+
+    // Scatter
+    case SCATTER:
+      execScatter(s, stmt->storeReq.data, stmt->storeReq.addr);
       return;
 
     // Host IRQ
@@ -23,6 +23,20 @@ const char* opToString(Op op)
     case BNOT:   return "~";
     case ItoF:   return "(Float) ";
     case FtoI:   return "(Int) ";
+    case RECIP:     return "recip ";
+    case RECIPSQRT: return "rsqrt ";
+    case EXP:       return "exp2 ";
+    case LOG:       return "log2 ";
+    case DIV:       return " / ";
+    case SQRT:      return "sqrt ";
+    case MOD:       return " % ";
+    case REDUCE_ADD: return "reduceAdd ";
+    case REDUCE_MIN: return "reduceMin ";
+    case REDUCE_MAX: return "reduceMax ";
+    case REDUCE_AND: return "reduceAnd ";
+    case REDUCE_OR:  return "reduceOr ";
+    case UNPACK:     return " unpack ";
+    case PACK:       return " pack ";
   }
 
   // Not reachable
@@ -100,6 +114,17 @@ void pretty(Expr* e)
       pretty(e->deref.ptr);
       break;
 
+    // Selection
+    case SELECT:
+      printf("(");
+      pretty(e->select.cond);
+      printf(" ? ");
+      pretty(e->select.lhs);
+      printf(" : ");
+      pretty(e->select.rhs);
+      printf(")");
+      break;
+
   }
 }
 
@@ -276,6 +301,17 @@ void pretty(int indent, Stmt* s)
       printf(")\n");
       break;
 
+    // Partial load
+    case LOAD_PARTIAL:
+      indentBy(indent);
+      pretty(s->loadReq.dest);
+      printf(" = load(");
+      pretty(s->loadReq.addr);
+      printf(", ");
+      pretty(s->loadReq.count);
+      printf(")\n");
+      break;
+
     // Store request
     case STORE_REQUEST:
       indentBy(indent);
@@ -283,6 +319,47 @@ void pretty(int indent, Stmt* s)
       pretty(s->storeReq.data);
       printf(", ");
       pretty(s->storeReq.addr);
+      if (s->storeReq.count != NULL) {
+        printf(", ");
+        pretty(s->storeReq.count);
+      }
+      printf(")\n");
+      break;
+
+    // Shared access
+    case SHARED:
+      indentBy(indent);
+      switch (s->shared.op) {
+        case SHARED_READ:
+          pretty(s->shared.data);
+          printf(" = sharedRead(");
+          pretty(s->shared.index);
+          break;
+        case SHARED_WRITE:
+          printf("sharedWrite(");
+          pretty(s->shared.index);
+          printf(", ");
+          pretty(s->shared.data);
+          break;
+        case SHARED_LOAD:
+        case SHARED_STORE:
+          printf(s->shared.op == SHARED_LOAD ? "sharedLoad(" : "sharedStore(");
+          pretty(s->shared.index);
+          printf(", ");
+          pretty(s->shared.addr);
+          printf(", %d", s->shared.count);
+          break;
+      }
+      printf(")\n");
+      break;
+
+    // Scatter
+    case SCATTER:
+      indentBy(indent);
+      printf("scatter(");
+      pretty(s->storeReq.data);
+      printf(", ");
+      pretty(s->storeReq.addr);
       printf(")\n");
       break;
 
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Source/Shared.h"
+#include "Source/Stmt.h"
+
+// Number of scratchpad vectors allocated so far
+static int sharedUsed = 0;
+
+int sharedAlloc(int n)
+{
+  if (sharedUsed + n > SHARED_VECTORS) {
+    printf("QPULib: 'Shared' arrays exceed the %d vectors of VPM "
+           "scratchpad\n", SHARED_VECTORS);
+    exit(-1);
+  }
+  int base = sharedUsed;
+  sharedUsed += n;
+  return base;
+}
+
+void sharedReset()
+{
+  sharedUsed = 0;
+}
+
+void sharedStmt(SharedOp op, Expr* index, Expr* data, Expr* addr, int count,
+                int base, int size)
+{
+  Stmt* s = mkStmt();
+  s->tag          = SHARED;
+  s->shared.op    = op;
+  s->shared.index = index;
+  s->shared.data  = data;
+  s->shared.addr  = addr;
+  s->shared.count = count;
+  s->shared.base  = base;
+  s->shared.size  = size;
+  stmtStack.replace(mkSeq(stmtStack.top(), s));
+}
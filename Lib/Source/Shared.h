@@ -0,0 +1,100 @@
+// This module defines type 'Shared<T, N>' for an array of N elements
+// of type 'T' (Int or Float) held in the VPM and shared by all QPUs.
+
+#ifndef _SOURCE_SHARED_H_
+#define _SOURCE_SHARED_H_
+
+#include <assert.h>
+#include "Source/Syntax.h"
+#include "Source/Int.h"
+#include "Source/Float.h"
+#include "Source/Ptr.h"
+
+// The VPM is divided into 64 vectors of 16 words.  Each QPU has one
+// vector for staging loads and another for staging stores, and 32
+// vectors make up the scratchpad from which 'Shared' arrays are
+// allocated.
+
+#define SHARED_VECTORS 32
+
+// Allocate n vectors of the scratchpad, returning the first
+int sharedAlloc(int n);
+
+// Free the whole scratchpad (at the start of each kernel)
+void sharedReset();
+
+// Append a statement accessing vectors index to index+count-1 of the
+// scratchpad, within the array of 'size' vectors from 'base'
+void sharedStmt(SharedOp op, Expr* index, Expr* data, Expr* addr, int count,
+                int base, int size);
+
+// Expression type for each element type
+template <typename T> struct SharedExpr;
+template <> struct SharedExpr<Int>   { typedef IntExpr   Type; };
+template <> struct SharedExpr<Float> { typedef FloatExpr Type; };
+
+// ============================================================================
+// Types
+// ============================================================================
+
+// A 'Shared<T, N>' is accessed a vector at a time, vector i holding
+// elements 16*i to 16*i+15, so N must be a multiple of 16.  Accesses
+// by different QPUs are not ordered, so use 'barrier()' between
+// writing and reading.  'loadTile' and 'storeTile' copy n whole
+// vectors between the array and consecutive words of memory, and
+// complete before returning.  None of these are allowed in 'Where'.
+
+template <typename T, int N> struct Shared {
+  typedef typename SharedExpr<T>::Type TExpr;
+
+  // First vector of the array in the scratchpad
+  int base;
+
+  static_assert(N > 0 && N % 16 == 0,
+                "Shared<T, N>: N must be a positive multiple of 16");
+
+  Shared() {
+    base = sharedAlloc(N/16);
+  }
+
+  // Read vector i
+  TExpr read(IntExpr i) {
+    TExpr x;
+    x.expr = mkVar(freshVar());
+    access(SHARED_READ, i, x.expr, NULL, 1);
+    return x;
+  }
+
+  // Write x to vector i
+  void write(IntExpr i, TExpr x)
+    { access(SHARED_WRITE, i, x.expr, NULL, 1); }
+
+  // Copy n vectors from p to vectors i onwards
+  void loadTile(IntExpr i, PtrExpr<T> p, int n = 1)
+    { tile(SHARED_LOAD, i, p.expr, n); }
+  void loadTile(IntExpr i, Ptr<T>& p, int n = 1)
+    { tile(SHARED_LOAD, i, p.expr, n); }
+
+  // Copy n vectors from vector i onwards to p
+  void storeTile(IntExpr i, PtrExpr<T> p, int n = 1)
+    { tile(SHARED_STORE, i, p.expr, n); }
+  void storeTile(IntExpr i, Ptr<T>& p, int n = 1)
+    { tile(SHARED_STORE, i, p.expr, n); }
+
+ private:
+  // Vectors i to i+n-1 must lie in the array: this is checked here
+  // when i is a literal, and otherwise by the interpreter
+  void access(SharedOp op, IntExpr i, Expr* data, Expr* p, int n) {
+    assert(n > 0 && n <= N/16);
+    if (i.expr->tag == INT_LIT)
+      assert(i.expr->intLit >= 0 && i.expr->intLit + n <= N/16);
+    Expr* k = i.expr;
+    if (base != 0) k = mkApply(k, mkOp(ADD, INT32), mkIntLit(base));
+    sharedStmt(op, k, data, p, n, base, N/16);
+  }
+
+  void tile(SharedOp op, IntExpr i, Expr* p, int n)
+    { access(op, i, NULL, p, n); }
+};
+
+#endif
@@ -2,14 +2,31 @@
 #include "Common/Stack.h"
 #include "Source/Stmt.h"
 #include "Source/Int.h"
+#include "Source/Unroll.h"
+#include "Source/Shared.h"
 
 // Interface to the embedded language.
 
+// Unroll factor requested for the next 'For' loop, and for the 'For'
+// loop whose initialiser is being built
+static int pendingUnroll = 1;
+static int forUnroll     = 1;
+
+// Check that an 'Unroll' is not applied to anything but a 'For' loop
+static void noUnroll()
+{
+  if (pendingUnroll != 1) {
+    printf("Syntax error: 'Unroll' must precede a 'For' loop\n");
+    exit(-1);
+  }
+}
+
 //=============================================================================
 // Assignment token
 //=============================================================================
 
 void assign(Expr* lhs, Expr* rhs) {
+  noUnroll();
   Stmt* s = mkAssign(lhs, rhs);
   stmtStack.replace(mkSeq(stmtStack.top(), s));
 }
@@ -20,6 +37,7 @@ void assign(Expr* lhs, Expr* rhs) {
 
 void If_(Cond c)
 {
+  noUnroll();
   Stmt* s = mkIf(c.cexpr, NULL, NULL);
   controlStack.push(s);
   stmtStack.push(mkSkip());
@@ -36,6 +54,7 @@ void If_(BoolExpr b)
 
 void Else_()
 {
+  noUnroll();
   int ok = 0;
   if (controlStack.size > 0) {
     Stmt* s = controlStack.top();
@@ -63,6 +82,7 @@ void Else_()
 
 void End_()
 {
+  noUnroll();
   int ok = 0;
   if (controlStack.size > 0) {
     Stmt* s = controlStack.top();
@@ -87,12 +107,23 @@ void End_()
       ok = 1;
     }
     if (s->tag == FOR && s->forLoop.body == NULL) {
-      // Convert 'for' loop to 'while' loop
-      CExpr* whileCond = s->forLoop.cond;
-      Stmt* whileBody = mkSeq(stmtStack.top(), s->forLoop.inc);
-      s->tag = WHILE;
-      s->loop.body = whileBody;
-      s->loop.cond = whileCond;
+      Stmt* unrolled = NULL;
+      if (s->forLoop.unroll > 1)
+        unrolled = unrollFor(s->forLoop.cond, s->forLoop.inc,
+                             stmtStack.top(), s->forLoop.unroll,
+                             s->forLoop.firstLocal);
+      if (unrolled != NULL) {
+        // Replace 'for' loop with unrolled 'while' loops
+        *s = *unrolled;
+      }
+      else {
+        // Convert 'for' loop to 'while' loop
+        CExpr* whileCond = s->forLoop.cond;
+        Stmt* whileBody = mkSeq(stmtStack.top(), s->forLoop.inc);
+        s->tag = WHILE;
+        s->loop.body = whileBody;
+        s->loop.cond = whileCond;
+      }
       ok = 1;
     }
 
@@ -115,6 +146,7 @@ void End_()
 
 void While_(Cond c)
 {
+  noUnroll();
   Stmt* s = mkWhile(c.cexpr, NULL);
   controlStack.push(s);
   stmtStack.push(mkSkip());
@@ -129,9 +161,11 @@ void While_(BoolExpr b)
 // 'Where' token
 //=============================================================================
 
-void Where__(BExpr* b)
+void Where__(BExpr* b, WhereHint hint)
 {
+  noUnroll();
   Stmt* s = mkWhere(b, NULL, NULL);
+  s->where.hint = hint;
   controlStack.push(s);
   stmtStack.push(mkSkip());
 }
@@ -140,9 +174,20 @@ void Where__(BExpr* b)
 // 'For' token
 //=============================================================================
 
+// The unroll factor is taken before the initialiser, which is built
+// between 'Unroll' and 'For_'
+
+void ForInit_()
+{
+  forUnroll = pendingUnroll;
+  pendingUnroll = 1;
+}
+
 void For_(Cond c)
 {
   Stmt* s = mkFor(c.cexpr, NULL, NULL);
+  s->forLoop.unroll = forUnroll;
+  forUnroll = 1;
   controlStack.push(s);
   stmtStack.push(mkSkip());
 }
@@ -156,10 +201,25 @@ void ForBody_()
 {
   Stmt* s = controlStack.top();
   s->forLoop.inc = stmtStack.top();
+  s->forLoop.firstLocal = getFreshVarCount();
   stmtStack.pop();
   stmtStack.push(mkSkip());
 }
 
+//=============================================================================
+// 'Unroll' token
+//=============================================================================
+
+void Unroll_(int n)
+{
+  if (n < 1) {
+    printf("QPULib: unroll factor must be at least 1\n");
+    exit(-1);
+  }
+  noUnroll();
+  pendingUnroll = n;
+}
+
 //=============================================================================
 // 'Print' token
 //=============================================================================
@@ -203,11 +263,314 @@ void setWriteStride(IntExpr stride)
 }
 
 // ============================================================================
-// QPU code for clean exit
+// Barrier
 // ============================================================================
 
+// QPU 0 waits for the other QPUs to arrive on semaphore 14, then
+// releases them on semaphore 13.  Each released QPU acknowledges on
+// semaphore 14 and waits for a second release on semaphore 12, which
+// QPU 0 gives only once every QPU has taken its first.  Without this
+// second round a QPU could pass the barrier, reach it again, and take
+// a release meant for a QPU that has not yet woken up.
+
+void barrier()
+{
+  // Make this QPU's stores visible to the others
+  flush();
+
+  If (me() == 0)
+    Int n = numQPUs()-1;
+    for (int round = 0; round < 2; round++) {
+      For (Int i = 0, i < n, i++)
+        semaDec(14);
+      End
+      For (Int i = 0, i < n, i++)
+        semaInc(13 - round);
+      End
+    }
+  Else
+    for (int round = 0; round < 2; round++) {
+      semaInc(14);
+      semaDec(13 - round);
+    }
+  End
+}
+
+// ============================================================================
+// Shared memory lock
+// ============================================================================
+
+// Read-modify-write sequences on shared memory are guarded by
+// semaphore 11, which holds one token while the kernel runs.  QPU 0
+// provides the token at the start of the kernel and takes it back at
+// the end, but only in kernels that use the lock, so the code for this
+// is added by 'kernelFinish()' into a placeholder left by
+// 'kernelStart()'.
+
+static Stmt* lockInit = NULL;
+static bool lockUsed  = false;
+
+static void lock()
+{
+  lockUsed = true;
+  semaDec(11);
+}
+
+// Complete the stores made under the lock before releasing it
+static void unlock()
+{
+  flush();
+  semaInc(11);
+}
+
+// ============================================================================
+// Work queue
+// ============================================================================
+
+IntExpr nextWorkItem(Ptr<Int> counter, int chunk, IntExpr n)
+{
+  assert(chunk > 0);
+
+  lock();
+  Int item = *counter;
+
+  // Each QPU takes one chunk at or beyond n before leaving its loop,
+  // so the last QPU to leave can tell, and resets the counter
+  Int last = ((n + (chunk-1)) / chunk + numQPUs() - 1) * chunk;
+  *counter = select(item == last, IntExpr(0), item + chunk);
+  unlock();
+
+  return item;
+}
+
+// ============================================================================
+// Partial loads and stores
+// ============================================================================
+
+// The DMA takes the count from lane 0, so test and mask with that
+
+static IntExpr loadPartial(Expr* p, IntExpr count)
+{
+  Int n = min(broadcast(count, 0), 16);
+  Int x = 0;
+  If (n > 0)
+    loadExpr(x.expr, p, n.expr);
+    Where (index() >= n) x = 0; End
+  End
+  return x;
+}
+
+IntExpr load(PtrExpr<Int> p, IntExpr count)
+  { return loadPartial(p.expr, count); }
+
+IntExpr load(Ptr<Int>& p, IntExpr count)
+  { return loadPartial(p.expr, count); }
+
+FloatExpr load(PtrExpr<Float> p, IntExpr count)
+{
+  FloatExpr x; x.expr = loadPartial(p.expr, count).expr;
+  return x;
+}
+
+FloatExpr load(Ptr<Float>& p, IntExpr count)
+{
+  FloatExpr x; x.expr = loadPartial(p.expr, count).expr;
+  return x;
+}
+
+static void storePartial(Expr* data, Expr* p, IntExpr count)
+{
+  Int n = min(broadcast(count, 0), 16);
+  If (n > 0)
+    storeExpr(data, p, n.expr);
+  End
+}
+
+void store(IntExpr data, PtrExpr<Int> p, IntExpr count)
+  { storePartial(data.expr, p.expr, count); }
+
+void store(FloatExpr data, PtrExpr<Float> p, IntExpr count)
+  { storePartial(data.expr, p.expr, count); }
+
+void store(IntExpr data, Ptr<Int>& p, IntExpr count)
+  { storePartial(data.expr, p.expr, count); }
+
+void store(FloatExpr data, Ptr<Float>& p, IntExpr count)
+  { storePartial(data.expr, p.expr, count); }
+
+// ============================================================================
+// Atomic operations
+// ============================================================================
+
+// The old values are loaded into the only temporary, and the update
+// is evaluated under the lock
+
+static Expr* atomicOp(Expr* p, Op op, Expr* x)
+{
+  Var old = freshVar();
+  lock();
+  assign(mkVar(old), mkDeref(p));
+  assign(mkDeref(p), mkApply(mkVar(old), op, x));
+  unlock();
+  return mkVar(old);
+}
+
+static IntExpr atomicInt(Expr* p, OpId op, IntExpr x)
+{
+  IntExpr y; y.expr = atomicOp(p, mkOp(op, INT32), x.expr);
+  return y;
+}
+
+static FloatExpr atomicFloat(Expr* p, OpId op, FloatExpr x)
+{
+  FloatExpr y; y.expr = atomicOp(p, mkOp(op, FLOAT), x.expr);
+  return y;
+}
+
+IntExpr atomicAdd(PtrExpr<Int> p, IntExpr x)
+  { return atomicInt(p.expr, ADD, x); }
+
+IntExpr atomicMin(PtrExpr<Int> p, IntExpr x)
+  { return atomicInt(p.expr, MIN, x); }
+
+IntExpr atomicMax(PtrExpr<Int> p, IntExpr x)
+  { return atomicInt(p.expr, MAX, x); }
+
+IntExpr atomicAdd(Ptr<Int>& p, IntExpr x)
+  { return atomicInt(p.expr, ADD, x); }
+
+IntExpr atomicMin(Ptr<Int>& p, IntExpr x)
+  { return atomicInt(p.expr, MIN, x); }
+
+IntExpr atomicMax(Ptr<Int>& p, IntExpr x)
+  { return atomicInt(p.expr, MAX, x); }
+
+FloatExpr atomicAdd(PtrExpr<Float> p, FloatExpr x)
+  { return atomicFloat(p.expr, ADD, x); }
+
+FloatExpr atomicMin(PtrExpr<Float> p, FloatExpr x)
+  { return atomicFloat(p.expr, MIN, x); }
+
+FloatExpr atomicMax(PtrExpr<Float> p, FloatExpr x)
+  { return atomicFloat(p.expr, MAX, x); }
+
+FloatExpr atomicAdd(Ptr<Float>& p, FloatExpr x)
+  { return atomicFloat(p.expr, ADD, x); }
+
+FloatExpr atomicMin(Ptr<Float>& p, FloatExpr x)
+  { return atomicFloat(p.expr, MIN, x); }
+
+FloatExpr atomicMax(Ptr<Float>& p, FloatExpr x)
+  { return atomicFloat(p.expr, MAX, x); }
+
+// ============================================================================
+// Persistent kernels
+// ============================================================================
+
+// The layout of a work queue is given in 'VideoCore/WorkQueue.h'.  A
+// slot is claimed under the lock, by advancing the claim counter while
+// it is behind the submission count, and its last word is set to -1
+// under the lock once the body has finished with it.  Both words are
+// transferred alone, by one-lane loads and stores.  When there is
+// nothing to claim, the QPU polls until more work arrives or the host
+// asks the kernel to stop.
+
+IntExpr nextDescriptor(Ptr<Int> queue, IntExpr done)
+{
+  Int prev = done;
+  Int slot = -2;
+  While (slot == -2)
+    lock();
+    Int hdr = queue[0];
+    If (prev >= 0)
+      store(IntExpr(-1), queue + prev + 15, 1);
+      flush();
+      prev = -1;
+    End
+    Int claimed = load(queue + 16, 1);
+    claimed = broadcast(claimed, 0);
+    If (claimed < broadcast(hdr, 0))
+      store(claimed + 1, queue + 16, 1);
+      slot = 32 + 16*(claimed & broadcast(hdr, 2));
+    Else
+      If (broadcast(hdr, 1) != 0) slot = -1; End
+    End
+    unlock();
+  End
+  return slot;
+}
+
+// ============================================================================
+// Ring buffers
+// ============================================================================
+
+// The layout of a ring is given in 'VideoCore/RingBuffer.h'.  Only
+// lane 0 of the head and tail words is meaningful, and each side
+// updates its own with a one-word store, after flushing the data.
+
+static IntExpr ringPop(Expr* ring)
+{
+  PtrExpr<Int> r; r.expr = ring;
+  Int hdr  = r[0];
+  Int tail = broadcast(r[16], 0);
+  While (broadcast(hdr, 0) == tail)
+    hdr = r[0];
+  End
+  Int x = r[32 + 16*(tail & broadcast(hdr, 1))];
+  store(tail + 1, r + 16, 1);
+  flush();
+  return x;
+}
+
+static void ringPush(Expr* ring, Expr* data)
+{
+  PtrExpr<Int> r; r.expr = ring;
+  IntExpr e; e.expr = data;
+  Int x    = e;
+  Int hdr  = r[0];
+  Int head = broadcast(hdr, 0);
+  Int mask = broadcast(hdr, 1);
+  Int tail = broadcast(r[16], 0);
+  While (head - tail > mask)
+    tail = broadcast(r[16], 0);
+  End
+  r[32 + 16*(head & mask)] = x;
+  flush();
+  store(head + 1, r, 1);
+  flush();
+}
+
+IntExpr pop(Ptr<Int>& ring)
+  { return ringPop(ring.expr); }
+
+FloatExpr pop(Ptr<Float>& ring)
+{
+  FloatExpr x; x.expr = ringPop(ring.expr).expr;
+  return x;
+}
+
+void push(Ptr<Int>& ring, IntExpr x)
+  { ringPush(ring.expr, x.expr); }
+
+void push(Ptr<Float>& ring, FloatExpr x)
+  { ringPush(ring.expr, x.expr); }
+
+// ============================================================================
+// QPU code for clean start and exit
+// ============================================================================
+
+void kernelStart()
+{
+  lockUsed = false;
+  lockInit = mkSkip();
+  sharedReset();
+  stmtStack.replace(mkSeq(stmtStack.top(), lockInit));
+}
+
 void kernelFinish()
 {
+  noUnroll();
+
   // Ensure outstanding stores have completed
   flush();
 
@@ -218,8 +581,19 @@ void kernelFinish()
     For (Int i = 0, i < n, i++)
       semaDec(15);
     End
+    if (lockUsed) semaDec(11);
     hostIRQ();
   Else
     semaInc(15);
   End
+
+  // Provide the lock token
+  if (lockUsed) {
+    stmtStack.push(mkSkip());
+    If (me() == 0)
+      semaInc(11);
+    End
+    *lockInit = *stmtStack.top();
+    stmtStack.pop();
+  }
 }
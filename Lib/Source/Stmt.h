@@ -14,13 +14,60 @@
 #define Else     } Else_(); {
 #define End      } End_();
 #define While(c) While_(c); {
-#define Where(b) Where_(b); {
+#define Where(...) Where_(__VA_ARGS__); {
+
+// 'Unroll(n)' may precede a 'For' loop to request that its body be
+// replicated n times, e.g. Unroll(4) For (Int i = 0, i < n, i++) ...
+// Loops whose condition does not compare i with a bound that a step
+// 'i = i + s' or 'i = i - s' moves towards are left as is.  The n-1
+// steps taken before the loop condition is next tested must not
+// overflow an int.  Anything else following 'Unroll' is a syntax error.
+
+#define Unroll(n) Unroll_(n);
 #define For(init, cond, inc) \
-  { init;                    \
+  { ForInit_();              \
+    init;                    \
     For_(cond);              \
       inc;                   \
     ForBody_();
 
+// 'ParallelFor(i, count, n)' strip-mines the range 0 to n-1 over the
+// lanes and QPUs.  Each iteration covers the 16 elements from i, of
+// which the first 'count' are in range, e.g.
+//
+//   ParallelFor (i, count, n)
+//     store(load(p + i, count) * 2, q + i, count);
+//   End
+
+#define ParallelFor(i, count, n)                               \
+  For (Int i = 16*me(), i < (n), i = i + 16*numQPUs())          \
+    Int count = min((n) - i, 16);
+
+#define ParFor(i, n, counter, chunk)                           \
+  For (Int i = nextWorkItem(counter, chunk, n), i < n,          \
+       i = nextWorkItem(counter, chunk, n))
+
+// 'Persistent(desc, queue)' runs its body once for each descriptor
+// submitted to a 'WorkQueue', with 'desc' holding the descriptor, and
+// finishes when the host stops the queue, e.g.
+//
+//   Persistent (desc, queue)
+//     Int i = broadcast(desc, 0);
+//     ...
+//   End
+
+#define Persistent(desc, queue)                                     \
+  For (Int desc##Slot = nextDescriptor(queue, -1), desc##Slot >= 0, \
+       desc##Slot = nextDescriptor(queue, desc##Slot))             \
+    Int desc = queue[desc##Slot];
+
+// Optional second argument to 'Where', overriding the compiler's
+// choice of whether to branch over the body when no lane is active,
+// e.g. Where(x > 0, Branchy)
+
+const WhereHint Branchy    = WHERE_BRANCHY;
+const WhereHint Predicated = WHERE_PREDICATED;
+
 //=============================================================================
 // Statement tokens
 //=============================================================================
@@ -32,15 +79,86 @@ void Else_();
 void End_();
 void While_(Cond c);
 void While_(BoolExpr b);
-void Where__(BExpr* b);
-inline void Where_(BoolExpr b) { Where__(b.bexpr); }
+void Where__(BExpr* b, WhereHint hint);
+inline void Where_(BoolExpr b, WhereHint hint = WHERE_AUTO)
+  { Where__(b.bexpr, hint); }
+void ForInit_();
 void For_(Cond c);
 void For_(BoolExpr b);
 void ForBody_();
+void Unroll_(int n);
 void Print(const char *);
 void Print(IntExpr x);
 void setReadStride(IntExpr n);
 void setWriteStride(IntExpr n);
+void kernelStart();
 void kernelFinish();
 
+// Load or store only the first 'count' lanes (taken from lane 0) of a
+// vector, shortening the DMA so that no memory beyond them is read or
+// written.  Loaded lanes from 'count' on are zero.  Nothing is read or
+// written when 'count' is zero or less.
+IntExpr load(PtrExpr<Int> p, IntExpr count);
+FloatExpr load(PtrExpr<Float> p, IntExpr count);
+IntExpr load(Ptr<Int>& p, IntExpr count);
+FloatExpr load(Ptr<Float>& p, IntExpr count);
+void store(IntExpr data, PtrExpr<Int> p, IntExpr count);
+void store(FloatExpr data, PtrExpr<Float> p, IntExpr count);
+void store(IntExpr data, Ptr<Int>& p, IntExpr count);
+void store(FloatExpr data, Ptr<Float>& p, IntExpr count);
+
+// Wait until every QPU has reached the barrier.  All QPUs must call
+// 'barrier()' the same number of times, and not inside 'Where'.  It
+// uses semaphores 12 to 14 (and 'kernelFinish()' uses 15).
+void barrier();
+
+// Take the next 'chunk' items from a work counter shared by all QPUs,
+// returning the first (the same in every lane).  Items at or beyond n
+// mean there is no work left, and each QPU must then stop asking.  The
+// counter is the first of 16 words, must be zero when first used, and
+// is zero again once every QPU has stopped.  It uses the same lock
+// as the atomic operations below.
+//
+// 'ParFor(i, n, counter, chunk)' loops over chunks in this way, e.g.
+// ParFor (row, height, counter, 1) ... End.  Loops sharing a counter
+// must be separated by a 'barrier()'.
+IntExpr nextWorkItem(Ptr<Int> counter, int chunk, IntExpr n);
+
+// Signal that the descriptor in slot 'done' of a work queue has been
+// processed, unless 'done' is negative, and wait for the next one,
+// returning the word offset of its slot, or -1 once the queue has been
+// stopped and emptied.  All QPUs may serve the same queue.  It uses the
+// same lock as the atomic operations below.
+IntExpr nextDescriptor(Ptr<Int> queue, IntExpr done);
+
+// Take the next vector from a 'RingBuffer', waiting until there is
+// one, or add a vector to it, waiting until there is space.  Only one
+// QPU may pop from, or push to, a given ring, and not inside 'Where'.
+IntExpr pop(Ptr<Int>& ring);
+FloatExpr pop(Ptr<Float>& ring);
+void push(Ptr<Int>& ring, IntExpr x);
+void push(Ptr<Float>& ring, FloatExpr x);
+
+// Atomically update the 16 consecutive words at p with x, lane i
+// updating word i, returning their previous values.  Like '*p', this
+// reads and writes a whole vector at the address in lane 0, so all 16
+// words are written: a lane leaves its word unchanged by passing 0 to
+// 'atomicAdd'.  For example, atomicAdd(p + 16*i, x) updates row i,
+// for i the same in every lane.  Updates by different QPUs are
+// serialised by a lock on semaphore 11, and each is stored before the
+// lock is released.  The result is a variable holding the loaded
+// values.  Not supported inside 'Where' or in loop conditions.
+IntExpr atomicAdd(PtrExpr<Int> p, IntExpr x);
+IntExpr atomicMin(PtrExpr<Int> p, IntExpr x);
+IntExpr atomicMax(PtrExpr<Int> p, IntExpr x);
+IntExpr atomicAdd(Ptr<Int>& p, IntExpr x);
+IntExpr atomicMin(Ptr<Int>& p, IntExpr x);
+IntExpr atomicMax(Ptr<Int>& p, IntExpr x);
+FloatExpr atomicAdd(PtrExpr<Float> p, FloatExpr x);
+FloatExpr atomicMin(PtrExpr<Float> p, FloatExpr x);
+FloatExpr atomicMax(PtrExpr<Float> p, FloatExpr x);
+FloatExpr atomicAdd(Ptr<Float>& p, FloatExpr x);
+FloatExpr atomicMin(Ptr<Float>& p, FloatExpr x);
+FloatExpr atomicMax(Ptr<Float>& p, FloatExpr x);
+
 #endif
@@ -66,12 +66,23 @@ inline void receive(Float& dest)
 template <typename T> inline void receive(Ptr<T>& dest)
   { receiveExpr(dest.expr); }
 
-inline void storeExpr(Expr* e0, Expr* e1)
+inline void loadExpr(Expr* dest, Expr* addr, Expr* count)
+{
+  Stmt* s = mkStmt();
+  s->tag = LOAD_PARTIAL;
+  s->loadReq.dest  = dest;
+  s->loadReq.addr  = addr;
+  s->loadReq.count = count;
+  stmtStack.replace(mkSeq(stmtStack.top(), s));
+}
+
+inline void storeExpr(Expr* e0, Expr* e1, Expr* count = NULL)
 {
   Stmt* s = mkStmt();
   s->tag = STORE_REQUEST;
-  s->storeReq.data = e0;
-  s->storeReq.addr = e1;
+  s->storeReq.data  = e0;
+  s->storeReq.addr  = e1;
+  s->storeReq.count = count;
   stmtStack.replace(mkSeq(stmtStack.top(), s));
 }
 
@@ -87,6 +98,32 @@ inline void store(IntExpr data, Ptr<Int> &addr)
 inline void store(FloatExpr data, Ptr<Float> &addr)
   { storeExpr(data.expr, addr.expr); }
 
+// Write each lane of 'data' to the address held in the same lane
+// of 'addr'.  Like 'store', the final write may still be in flight
+// when 'scatter' returns; use 'flush' to wait for it.
+
+inline void scatterExpr(Expr* e0, Expr* e1)
+{
+  Stmt* s = mkStmt();
+  s->tag = SCATTER;
+  s->storeReq.data  = e0;
+  s->storeReq.addr  = e1;
+  s->storeReq.count = NULL;
+  stmtStack.replace(mkSeq(stmtStack.top(), s));
+}
+
+inline void scatter(IntExpr data, PtrExpr<Int> addr)
+  { scatterExpr(data.expr, addr.expr); }
+
+inline void scatter(FloatExpr data, PtrExpr<Float> addr)
+  { scatterExpr(data.expr, addr.expr); }
+
+inline void scatter(IntExpr data, Ptr<Int> &addr)
+  { scatterExpr(data.expr, addr.expr); }
+
+inline void scatter(FloatExpr data, Ptr<Float> &addr)
+  { scatterExpr(data.expr, addr.expr); }
+
 inline void flush()
 {
   Stmt* s = mkStmt();
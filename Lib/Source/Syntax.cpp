@@ -52,9 +52,14 @@ void resetFreshVarGen(int val)
 // ============================================================================
 
 Op mkOp(OpId op, BaseType type) {
+  return mkOp(op, type, PREC_REFINED);
+}
+
+Op mkOp(OpId op, BaseType type, Precision prec) {
   Op o;
   o.op   = op;
   o.type = type;
+  o.prec = prec;
   return o;
 }
 
@@ -68,7 +73,33 @@ CmpOp mkCmpOp(CmpOpId op, BaseType type) {
 // Is operator unary?
 bool isUnary(Op op)
 {
-  return (op.op == BNOT || op.op == ItoF || op.op == FtoI);
+  return (op.op == BNOT || op.op == ItoF || op.op == FtoI ||
+          op.op == SQRT || isSFU(op) || isReduce(op));
+}
+
+bool isSFU(Op op)
+{
+  return (op.op == RECIP || op.op == RECIPSQRT ||
+          op.op == EXP   || op.op == LOG);
+}
+
+bool isReduce(Op op)
+{
+  return (op.op == REDUCE_ADD || op.op == REDUCE_MIN ||
+          op.op == REDUCE_MAX || op.op == REDUCE_AND ||
+          op.op == REDUCE_OR);
+}
+
+Op reduceOp(Op op)
+{
+  switch (op.op) {
+    case REDUCE_ADD: return mkOp(ADD, op.type);
+    case REDUCE_MIN: return mkOp(MIN, op.type);
+    case REDUCE_MAX: return mkOp(MAX, op.type);
+    case REDUCE_AND: return mkOp(BAND, op.type);
+    case REDUCE_OR:  return mkOp(BOR, op.type);
+    default:         assert(false);
+  }
 }
 
 // Is given operator commutative?
@@ -143,6 +174,17 @@ Expr* mkDeref(Expr* ptr)
   return e;
 }
 
+// Make a lane-wise selection
+Expr* mkSelect(BExpr* cond, Expr* lhs, Expr* rhs)
+{
+  Expr* e        = mkExpr();
+  e->tag         = SELECT;
+  e->select.cond = cond;
+  e->select.lhs  = lhs;
+  e->select.rhs  = rhs;
+  return e;
+}
+
 // Is an expression a literal?
 bool isLit(Expr* e)
 {
@@ -265,6 +307,7 @@ Stmt* mkWhere(BExpr* cond, Stmt* thenStmt, Stmt* elseStmt)
   s->where.cond     = cond;
   s->where.thenStmt = thenStmt;
   s->where.elseStmt = elseStmt;
+  s->where.hint     = WHERE_AUTO;
   return s;
 }
 
@@ -294,6 +337,8 @@ Stmt* mkFor(CExpr* cond, Stmt* inc, Stmt* body)
   s->forLoop.cond = cond;
   s->forLoop.inc  = inc;
   s->forLoop.body = body;
+  s->forLoop.unroll = 1;
+  s->forLoop.firstLocal = 0;
   return s;
 }
 
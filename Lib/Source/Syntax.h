@@ -20,21 +20,53 @@ enum OpId {
   SHL, SHR, USHR, BOR, BAND, BXOR, BNOT, ROR,
 
   // Conversion operators:
-  ItoF, FtoI
+  ItoF, FtoI,
+
+  // Special function unit operators (Float only):
+  RECIP, RECIPSQRT, EXP, LOG,
+
+  // Division (Int & Float), square root (Float only) and modulo
+  // (Int only), which have no QPU instruction:
+  DIV, SQRT, MOD,
+
+  // Reductions across all lanes (AND and OR are Int only):
+  REDUCE_ADD, REDUCE_MIN, REDUCE_MAX, REDUCE_AND, REDUCE_OR,
+
+  // Sub-words, typed UINT8 or INT16 for bytes or half-words: UNPACK
+  // gives sub-word k of the lhs, k being a literal rhs; PACK gives the
+  // lhs with sub-word 1 replaced by the low bits of the rhs.  Typed
+  // FLOAT, for half-precision floats: UNPACK gives half-word k of the
+  // lhs as a float; PACK gives the lhs and rhs rounded to half
+  // precision in half-words 0 and 1.
+  UNPACK, PACK
 };
 
 // Every operator has a type associated with it
 enum BaseType { UINT8, INT16, INT32, FLOAT };
 
-// Pair containing operator and base type
-struct Op { OpId op; BaseType type; };
+// Precision of DIV and SQRT: the number of Newton-Raphson steps
+// applied to the SFU estimate
+enum Precision { PREC_APPROX = 0, PREC_REFINED = 1, PREC_PRECISE = 2 };
+
+// Operator and base type, plus precision for DIV and SQRT
+struct Op { OpId op; BaseType type; Precision prec; };
 
 // Construct an 'Op'
 Op mkOp(OpId op, BaseType type);
+Op mkOp(OpId op, BaseType type, Precision prec);
 
 // Is operator unary?
 bool isUnary(Op op);
 
+// Is operator evaluated by the special function unit?
+bool isSFU(Op op);
+
+// Is operator a cross-lane reduction?
+bool isReduce(Op op);
+
+// Lane-wise operator used by a reduction
+Op reduceOp(Op op);
+
 // Is operator commutative?
 bool isCommutative(Op op);
 
@@ -78,7 +110,9 @@ enum ReservedVarId {
 // ============================================================================
 
 // What kind of expression is it?
-enum ExprTag { INT_LIT, FLOAT_LIT, VAR, APPLY, DEREF };
+enum ExprTag { INT_LIT, FLOAT_LIT, VAR, APPLY, DEREF, SELECT };
+
+struct BExpr;
 
 struct Expr {
   // What kind of expression is it?
@@ -99,6 +133,9 @@ struct Expr {
 
     // Dereference a pointer
     struct { Expr* ptr; } deref;
+
+    // Lane-wise choice: lhs where cond holds, rhs elsewhere
+    struct { BExpr* cond; Expr* lhs; Expr* rhs; } select;
   };
 };
 
@@ -109,6 +146,7 @@ Expr* mkFloatLit(float lit);
 Expr* mkVar(Var var);
 Expr* mkApply(Expr* lhs, Op op, Expr* rhs);
 Expr* mkDeref(Expr* ptr);
+Expr* mkSelect(BExpr* cond, Expr* lhs, Expr* rhs);
 
 // Is an expression a literal?
 bool isLit(Expr* e);
@@ -204,8 +242,23 @@ enum StmtTag {
   SKIP, ASSIGN, SEQ, WHERE,
   IF, WHILE, PRINT, FOR,
   SET_READ_STRIDE, SET_WRITE_STRIDE,
-  LOAD_RECEIVE, STORE_REQUEST, FLUSH,
-  SEND_IRQ_TO_HOST, SEMA_INC, SEMA_DEC };
+  LOAD_RECEIVE, LOAD_PARTIAL, STORE_REQUEST, SCATTER, FLUSH,
+  SEND_IRQ_TO_HOST, SEMA_INC, SEMA_DEC, SHARED };
+
+// Access to the shared VPM scratchpad
+enum SharedOp {
+    SHARED_READ    // Read a vector into a variable
+  , SHARED_WRITE   // Write a vector
+  , SHARED_LOAD    // DMA consecutive vectors in from memory
+  , SHARED_STORE   // DMA consecutive vectors out to memory
+};
+
+// How should the body of a 'where' statement be compiled?
+enum WhereHint {
+    WHERE_AUTO         // Compiler decides, based on size of body
+  , WHERE_BRANCHY      // Branch over body when no lane is active
+  , WHERE_PREDICATED   // Never branch: predicate every instruction
+};
 
 struct Stmt {
   // What kind of statement is it?
@@ -219,7 +272,8 @@ struct Stmt {
     struct { Stmt* s0; Stmt* s1; } seq;
 
     // Where
-    struct { BExpr* cond; Stmt* thenStmt; Stmt* elseStmt; } where;
+    struct { BExpr* cond; Stmt* thenStmt; Stmt* elseStmt;
+             WhereHint hint; } where;
 
     // If
     struct { CExpr* cond; Stmt* thenStmt; Stmt* elseStmt; } ifElse;
@@ -228,7 +282,10 @@ struct Stmt {
     struct { CExpr* cond; Stmt* body; } loop;
 
     // For (only used intermediately during AST construction)
-    struct { CExpr* cond; Stmt* inc; Stmt* body; } forLoop;
+    // The unroll factor is 1 for no unrolling, and variables with ids
+    // from 'firstLocal' onwards are local to the body.
+    struct { CExpr* cond; Stmt* inc; Stmt* body;
+             int unroll; VarId firstLocal; } forLoop;
 
     // Print
     PrintStmt print;
@@ -239,11 +296,20 @@ struct Stmt {
     // Load receive destination
     Expr* loadDest;
 
-    // Store request
-    struct { Expr* data; Expr* addr; } storeReq;
+    // Partial load of the first 'count' lanes
+    struct { Expr* dest; Expr* addr; Expr* count; } loadReq;
+
+    // Store request ('count' is NULL when storing all lanes)
+    struct { Expr* data; Expr* addr; Expr* count; } storeReq;
 
     // Semaphore id for increment / decrement
     int semaId;
+
+    // Shared access to 'count' vectors from 'index' of the scratchpad,
+    // where 'data' is the variable read or the vector written, within
+    // the array of 'size' vectors from 'base'
+    struct { SharedOp op; Expr* index; Expr* data; Expr* addr;
+             int count; int base; int size; } shared;
   };
 };
 
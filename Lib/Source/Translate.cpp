@@ -1,3 +1,4 @@
+#include <float.h>
 #include "Source/Syntax.h"
 #include "Target/Syntax.h"
 #include "Target/SmallLiteral.h"
@@ -23,6 +24,17 @@ ALUOp opcode(Op op)
       default:     assert(false);
     }
   }
+  else if (op.type == UINT8) {
+    switch (op.op) {
+      case ADD:    return A_V8ADDS;
+      case SUB:    return A_V8SUBS;
+      case MUL:    return M_V8MUL;
+      case MIN:    return M_V8MIN;
+      case MAX:    return M_V8MAX;
+      case ROTATE: return M_ROTATE;
+      default:     assert(false);
+    }
+  }
   else {
     switch (op.op) {
       case ADD:    return A_ADD;
@@ -137,6 +149,29 @@ Expr* simplify(Seq<Instr>* seq, Expr* e);
 
 Expr* putInVar(Seq<Instr>* seq, Expr* e);
 
+// Expand division or square root, returning the final operation.
+
+Expr* refine(Seq<Instr>* seq, Op op, Expr* a, Expr* b);
+Expr* intDivide(Seq<Instr>* seq, Op op, Expr* a, Expr* b);
+
+// Round a float to half precision, giving a variable.
+
+Expr* roundHalf(Seq<Instr>* seq, Expr* f);
+
+// DMA load of *addr into v, and DMA store of data to *addr.
+
+void loadDeref(Seq<Instr>* seq, Var v, Expr* addr);
+void storeDeref(Seq<Instr>* seq, Expr* data, Expr* addr);
+
+// Evaluate a boolean expression into the condition flags (see below).
+
+AssignCond boolExp(Seq<Instr>* seq, BExpr* bexpr, Var v, bool modify);
+AssignCond negAssignCond(AssignCond cond);
+
+// Does evaluating an expression overwrite the condition flags?
+
+bool setsFlags(Expr* e);
+
 // ============================================================================
 // Variable assignments
 // ============================================================================
@@ -202,6 +237,147 @@ void varAssign( Seq<Instr>* seq   // Target instruction sequence to extend
     return;
   }
 
+  // -------------------------------------------
+  // Case: v := c ? x : y, a lane-wise selection
+  // -------------------------------------------
+  //
+  // Evaluate both alternatives before the condition, which sets the
+  // flags, and then move each into the lanes choosing it.  Selection
+  // inside 'where' is handled by 'whereStmt', as it overwrites the
+  // flags holding the 'where' condition.
+  //
+  if (e.tag == SELECT) {
+    assert(cond.tag == ALWAYS);
+    Expr* x = simplify(seq, e.select.lhs);
+    Expr* y = simplify(seq, e.select.rhs);
+    AssignCond c = boolExp(seq, e.select.cond, freshVar(), true);
+    varAssign(seq, c, v, x);
+    varAssign(seq, negAssignCond(c), v, y);
+    return;
+  }
+
+  // -------------------------------------------
+  // Case: v := x / y or v := x % y, on integers
+  // -------------------------------------------
+  //
+  // Division by a variable uses the condition flags, so inside
+  // 'where' it is evaluated unconditionally by 'whereStmt' first.
+  //
+  if (e.tag == APPLY && e.apply.op.type != FLOAT &&
+      (e.apply.op.op == DIV || e.apply.op.op == MOD)) {
+    assert(cond.tag == ALWAYS || !setsFlags(expr));
+    Expr* last = intDivide(seq, e.apply.op, e.apply.lhs, e.apply.rhs);
+    varAssign(seq, cond, v, last);
+    return;
+  }
+
+  // ----------------------------------------
+  // Case: v := unpack(x, k), a sub-word of x
+  // ----------------------------------------
+  //
+  // The unpack mode applies to reads of register file A, so x must
+  // be a variable, which register allocation then places there.  A
+  // half-word typed FLOAT is unpacked as a half-precision float.
+  //
+  if (e.tag == APPLY && e.apply.op.op == UNPACK) {
+    assert(e.apply.rhs->tag == INT_LIT);
+    Expr* x = e.apply.lhs;
+    if (x->tag != VAR || x->var.tag != STANDARD) {
+      AssignCond always;
+      always.tag = ALWAYS;
+      Var tmp = freshVar();
+      varAssign(seq, always, tmp, x);
+      x = mkVar(tmp);
+    }
+    int bits = e.apply.op.type == UINT8 ? 8 : 16;
+    bool isFloat = e.apply.op.type == FLOAT;
+
+    Instr instr;
+    instr.tag            = ALU;
+    instr.ALU.setFlags   = false;
+    instr.ALU.cond       = cond;
+    instr.ALU.dest       = dstReg(v);
+    instr.ALU.srcA.tag   = REG;
+    instr.ALU.srcA.reg   = srcReg(x->var);
+    instr.ALU.op         = isFloat ? A_FUNPACK : A_UNPACK;
+    instr.ALU.srcB       = instr.ALU.srcA;
+    instr.ALU.subWord    = subWord(bits, e.apply.rhs->intLit);
+    seq->append(instr);
+    return;
+  }
+
+  // ------------------------------------------------
+  // Case: v := pack(x, y), x with sub-word 1 set to y
+  // ------------------------------------------------
+  //
+  // A move of x followed by a move of y using the pack mode, which
+  // writes only the given sub-word of a register in register file A.
+  // A half-word pack of two byte packs writes three sub-words.  Floats
+  // are first rounded to half precision.
+  //
+  if (e.tag == APPLY && e.apply.op.op == PACK) {
+    if (e.apply.op.type == FLOAT) {
+      Expr* x = roundHalf(seq, e.apply.lhs);
+      Expr* y = roundHalf(seq, e.apply.rhs);
+      varAssign(seq, cond, v, mkApply(x, mkOp(PACK, INT16), y));
+      return;
+    }
+
+    Expr* lhs = e.apply.lhs;
+    Expr* rhs = e.apply.rhs;
+    Expr* parts[4];
+    SubWord subs[4];
+    int n;
+    if (e.apply.op.type == INT16 &&
+        lhs->tag == APPLY && lhs->apply.op.op == PACK &&
+        lhs->apply.op.type == UINT8 &&
+        rhs->tag == APPLY && rhs->apply.op.op == PACK &&
+        rhs->apply.op.type == UINT8) {
+      parts[0] = lhs->apply.lhs; subs[0] = A32;
+      parts[1] = lhs->apply.rhs; subs[1] = B8;
+      parts[2] = rhs->apply.lhs; subs[2] = C8;
+      parts[3] = rhs->apply.rhs; subs[3] = D8;
+      n = 4;
+    }
+    else {
+      parts[0] = lhs; subs[0] = A32;
+      parts[1] = rhs; subs[1] = e.apply.op.type == UINT8 ? B8 : B16;
+      n = 2;
+    }
+
+    // Evaluate the sub-words before writing to the destination,
+    // copying any that is the destination itself
+    AssignCond always;
+    always.tag = ALWAYS;
+    bool direct = cond.tag == ALWAYS && v.tag == STANDARD;
+    for (int i = 1; i < n; i++) {
+      parts[i] = putInVar(seq, parts[i]);
+      if (direct && parts[i]->var.tag == v.tag && parts[i]->var.id == v.id) {
+        Var tmp = freshVar();
+        varAssign(seq, always, tmp, parts[i]);
+        parts[i] = mkVar(tmp);
+      }
+    }
+
+    Var w = direct ? v : freshVar();
+    varAssign(seq, always, w, parts[0]);
+    for (int i = 1; i < n; i++) {
+      Instr instr;
+      instr.tag            = ALU;
+      instr.ALU.setFlags   = false;
+      instr.ALU.cond       = always;
+      instr.ALU.dest       = dstReg(w);
+      instr.ALU.srcA.tag   = REG;
+      instr.ALU.srcA.reg   = srcReg(parts[i]->var);
+      instr.ALU.op         = A_PACK;
+      instr.ALU.srcB       = instr.ALU.srcA;
+      instr.ALU.subWord    = subs[i];
+      seq->append(instr);
+    }
+    if (!direct) varAssign(seq, cond, v, mkVar(w));
+    return;
+  }
+
   // ----------------------------------------------
   // Case: v := x op y, where x or y are not simple
   // ----------------------------------------------
@@ -212,6 +388,30 @@ void varAssign( Seq<Instr>* seq   // Target instruction sequence to extend
     e.apply.rhs = simplify(seq, e.apply.rhs);
   }
 
+  // -------------------------------------------------
+  // Case: v := reduce(x), a reduction across all lanes
+  // -------------------------------------------------
+  //
+  // Combine each lane with the lane 8, 4, 2 and 1 places away, giving
+  // the result in every lane.  Each intermediate value lives only for
+  // the next two instructions, so is allocated to an accumulator.  The
+  // operand is needed in every lane, so this case comes before the one
+  // for literal operands, which assigns them under 'cond'.
+  //
+  if (e.tag == APPLY && isReduce(e.apply.op)) {
+    Op op  = reduceOp(e.apply.op);
+    Op rot = mkOp(ROTATE, e.apply.op.type);
+    Expr* x = e.apply.lhs;
+    for (int n = 8; n >= 1; n /= 2) {
+      Expr* y = mkApply(x, op, mkApply(x, rot, mkIntLit(n)));
+      if (n == 1)
+        varAssign(seq, cond, v, y);
+      else
+        x = putInVar(seq, y);
+    }
+    return;
+  }
+
   // --------------------------------------------------
   // Case: v := x op y, where x and y are both literals
   // --------------------------------------------------
@@ -221,6 +421,57 @@ void varAssign( Seq<Instr>* seq   // Target instruction sequence to extend
     e.apply.lhs = mkVar(tmpVar);
   }
  
+  // ---------------------------------------
+  // Case: v := x / y or v := sqrt(x)
+  // ---------------------------------------
+  if (e.tag == APPLY && (e.apply.op.op == DIV || e.apply.op.op == SQRT)) {
+    Expr* last = refine(seq, e.apply.op, e.apply.lhs, e.apply.rhs);
+    varAssign(seq, cond, v, last);
+    return;
+  }
+
+  // ----------------------------------------------------
+  // Case: v := f(x), where f is a special function (SFU)
+  // ----------------------------------------------------
+  //
+  // Writing x to the SFU register for f makes f(x) available in
+  // accumulator 4 two instructions later.
+  //
+  if (e.tag == APPLY && isSFU(e.apply.op)) {
+    Expr* x = putInVar(seq, e.apply.lhs);
+    Reg sfu;
+    sfu.tag = SPECIAL;
+    switch (e.apply.op.op) {
+      case RECIP:     sfu.regId = SPECIAL_SFU_RECIP;     break;
+      case RECIPSQRT: sfu.regId = SPECIAL_SFU_RECIPSQRT; break;
+      case EXP:       sfu.regId = SPECIAL_SFU_EXP;       break;
+      case LOG:       sfu.regId = SPECIAL_SFU_LOG;       break;
+      default:        assert(false);
+    }
+
+    Instr instr;
+    instr.tag                   = ALU;
+    instr.ALU.setFlags          = false;
+    instr.ALU.cond.tag          = ALWAYS;
+    instr.ALU.dest              = sfu;
+    instr.ALU.srcA.tag          = REG;
+    instr.ALU.srcA.reg          = srcReg(x->var);
+    instr.ALU.op                = A_BOR;
+    instr.ALU.srcB              = instr.ALU.srcA;
+    seq->append(instr);
+
+    seq->append(nop());
+    seq->append(nop());
+
+    instr.ALU.cond              = cond;
+    instr.ALU.dest              = dstReg(v);
+    instr.ALU.srcA.reg.tag      = ACC;
+    instr.ALU.srcA.reg.regId    = 4;
+    instr.ALU.srcB              = instr.ALU.srcA;
+    seq->append(instr);
+    return;
+  }
+
   // -------------------------------------------
   // Case: v := x op y, where x and y are simple
   // -------------------------------------------
@@ -259,19 +510,7 @@ void varAssign( Seq<Instr>* seq   // Target instruction sequence to extend
       printf("QPULib: dereferencing not yet supported inside 'where'\n");
       assert(false);
     }
-    Instr instr;
-    instr.tag        = LD1;
-    instr.LD1.addr   = srcReg(e.deref.ptr->var);
-    instr.LD1.buffer = A;
-    seq->append(instr);
-    instr.tag        = LD2;
-    seq->append(instr);
-    instr.tag        = LD3;
-    instr.LD3.buffer = A;
-    seq->append(instr);
-    instr.tag        = LD4;
-    instr.LD4.dest   = dstReg(v);
-    seq->append(instr);
+    loadDeref(seq, v, e.deref.ptr);
     return;
   }
 
@@ -310,6 +549,293 @@ Expr* putInVar(Seq<Instr>* seq, Expr* e)
     return e;
 }
 
+// A selection sets the flags, as does integer division by anything
+// but a non-zero literal (see 'divVar')
+
+bool setsFlags(Expr* e)
+{
+  if (e == NULL) return false;
+  switch (e->tag) {
+    case SELECT: return true;
+    case APPLY:
+      if (e->apply.op.type != FLOAT &&
+          (e->apply.op.op == DIV || e->apply.op.op == MOD) &&
+          (e->apply.rhs->tag != INT_LIT || e->apply.rhs->intLit == 0))
+        return true;
+      return setsFlags(e->apply.lhs) || setsFlags(e->apply.rhs);
+    case DEREF:  return setsFlags(e->deref.ptr);
+    default:     return false;
+  }
+}
+
+// Integer operations on temporaries, for the expansions below
+
+static Expr* intOp(Expr* a, OpId op, Expr* b)
+{
+  return mkApply(a, mkOp(op, INT32), b);
+}
+
+static Expr* intVar(Seq<Instr>* seq, Expr* e)
+{
+  AssignCond always;
+  always.tag = ALWAYS;
+  Var v = freshVar();
+  varAssign(seq, always, v, e);
+  return mkVar(v);
+}
+
+// Expand division and square root into SFU estimates refined by
+// Newton-Raphson steps, generating instructions for all but the final
+// multiplication, which is returned.
+//
+//   a / b:    r := recip(b)
+//             r := r * (2 - b*r)                     (each step)
+//             a * r
+//
+//   sqrt(a):  x := max(a, FLT_MIN); y := rsqrt(x); h := x/2
+//             y := y + y * (1/2 - h*(y*y))           (each step)
+//             (a * y) | nan(a)
+//
+// Clamping the operand of rsqrt gives sqrt(0) = 0 rather than 0 * inf.
+// As in C, the square root of a number below zero (but not of -0) is
+// NaN: nan(a) is the bits of a NaN when a is such a number, and zero
+// otherwise, found from the sign of (a-1) & a on a's bits.
+
+Expr* refine(Seq<Instr>* seq, Op op, Expr* a, Expr* b)
+{
+  AssignCond always;
+  always.tag = ALWAYS;
+  Op fadd = mkOp(ADD, FLOAT);
+  Op fsub = mkOp(SUB, FLOAT);
+  Op fmul = mkOp(MUL, FLOAT);
+
+  if (op.op == DIV) {
+    Expr* d = putInVar(seq, b);
+    Var r = freshVar();
+    varAssign(seq, always, r, mkApply(d, mkOp(RECIP, FLOAT), mkFloatLit(0)));
+    for (int i = 0; i < op.prec; i++) {
+      Expr* err = mkApply(mkFloatLit(2.0), fsub, mkApply(d, fmul, mkVar(r)));
+      varAssign(seq, always, r, mkApply(mkVar(r), fmul, err));
+    }
+    return mkApply(a, fmul, mkVar(r));
+  }
+
+  assert(op.op == SQRT);
+  a = putInVar(seq, a);
+  Var x = freshVar();
+  Var y = freshVar();
+  Var h = freshVar();
+  varAssign(seq, always, x,
+            mkApply(a, mkOp(MAX, FLOAT), mkFloatLit(FLT_MIN)));
+  varAssign(seq, always, y,
+            mkApply(mkVar(x), mkOp(RECIPSQRT, FLOAT), mkFloatLit(0)));
+  if (op.prec > 0)
+    varAssign(seq, always, h, mkApply(mkFloatLit(0.5), fmul, mkVar(x)));
+  for (int i = 0; i < op.prec; i++) {
+    Expr* yy  = mkApply(mkVar(y), fmul, mkVar(y));
+    Expr* err = mkApply(mkFloatLit(0.5), fsub, mkApply(mkVar(h), fmul, yy));
+    varAssign(seq, always, y,
+              mkApply(mkVar(y), fadd, mkApply(mkVar(y), fmul, err)));
+  }
+  Expr* neg = intOp(intOp(a, SUB, mkIntLit(1)), BAND, a);
+  Expr* nan = intVar(seq, intOp(intOp(neg, SHR, mkIntLit(31)),
+                                SHL, mkIntLit(22)));
+  Expr* r = intVar(seq, mkApply(a, fmul, mkVar(y)));
+  return intOp(r, BOR, nan);
+}
+
+// Integer division and modulo work on magnitudes, using the sign of
+// the operands to correct the result:
+//
+//   n := |a|;  q := n / |b|;  r := n - q*|b|
+//   a / b = q, negated if a and b differ in sign
+//   a % b = r, negated if a is negative
+//
+// For a literal divisor d that is not a power of two, n / |d| is the
+// high word of n * m, shifted right by l-1, where l = ceil(log2 |d|)
+// and m = ceil(2^(31+l) / |d|) fits in 32 bits.  This is exact for
+// all n <= 2^31.  As the QPU has only a 24-bit multiplier, 32-bit
+// products are built from 16-bit halves.
+
+// High word of the unsigned product of n and m
+
+static Expr* mulHigh(Seq<Instr>* seq, Expr* n, uint32_t m)
+{
+  Expr* ml = mkIntLit(m & 0xffff);
+  Expr* mh = mkIntLit(m >> 16);
+  Expr* nl = intVar(seq, intOp(n, BAND, mkIntLit(0xffff)));
+  Expr* nh = intVar(seq, intOp(n, USHR, mkIntLit(16)));
+  Expr* t  = intVar(seq, intOp(intOp(nh, MUL, ml), ADD,
+                               intOp(intOp(nl, MUL, ml), USHR, mkIntLit(16))));
+  Expr* u  = intOp(intOp(nl, MUL, mh), ADD, intOp(t, BAND, mkIntLit(0xffff)));
+  return intOp(intOp(intOp(nh, MUL, mh), ADD, intOp(t, USHR, mkIntLit(16))),
+               ADD, intOp(u, USHR, mkIntLit(16)));
+}
+
+// Low word of the product of q and d, which is known not to overflow
+
+static Expr* mulLow(Seq<Instr>* seq, Expr* q, uint32_t d)
+{
+  Expr* ql = intVar(seq, intOp(q, BAND, mkIntLit(0xffff)));
+  Expr* qh = intOp(q, USHR, mkIntLit(16));
+  Expr* dl = mkIntLit(d & 0xffff);
+  Expr* cross = intOp(qh, MUL, dl);
+  if (d >> 16)
+    cross = intOp(cross, ADD, intOp(ql, MUL, mkIntLit(d >> 16)));
+  return intOp(intOp(ql, MUL, dl), ADD, intOp(cross, SHL, mkIntLit(16)));
+}
+
+// Divide the magnitude n by a literal, giving the quotient or, if
+// 'mod' is set, the remainder
+
+static Expr* divLit(Seq<Instr>* seq, Expr* n, uint32_t d, bool mod)
+{
+  if ((d & (d-1)) == 0) {
+    int k = 0;
+    while ((1u << k) != d) k++;
+    return mod ? intOp(n, BAND, mkIntLit(d-1))
+               : intOp(n, USHR, mkIntLit(k));
+  }
+
+  int l = 0;
+  while ((1ull << l) < d) l++;
+  uint32_t m = (uint32_t) (((1ull << (31+l)) + d - 1) / d);
+  Expr* q = intOp(mulHigh(seq, n, m), USHR, mkIntLit(l-1));
+  return mod ? intOp(n, SUB, mulLow(seq, intVar(seq, q), d)) : q;
+}
+
+// Divide the magnitude n by the magnitude d using 32 steps of
+// shift-and-subtract, each comparing the partial remainder with d
+// via the sign of their difference.  This is exact even when the
+// partial remainder exceeds 2^31, as the difference always fits.
+
+static void divVar(Seq<Instr>* seq, Expr* n, Expr* d, Expr** q, Expr** r)
+{
+  AssignCond always;
+  always.tag = ALWAYS;
+
+  Var quot  = freshVar();
+  Var rem   = freshVar();
+  Var count = freshVar();
+  varAssign(seq, always, quot, n);
+  varAssign(seq, always, rem, mkIntLit(0));
+  varAssign(seq, always, count, mkIntLit(32));
+  Expr* top = intVar(seq, mkIntLit(31));
+
+  Instr instr;
+  Label loop = freshLabel();
+  instr.tag   = LAB;
+  instr.label = loop;
+  seq->append(instr);
+
+  // Shift next bit of dividend into remainder
+  varAssign(seq, always, rem,
+    intOp(intOp(mkVar(rem), SHL, mkIntLit(1)), BOR,
+          intOp(mkVar(quot), USHR, top)));
+  varAssign(seq, always, quot, intOp(mkVar(quot), SHL, mkIntLit(1)));
+
+  // If remainder >= d then subtract d and set quotient bit, using a
+  // mask of the sign of the difference rather than the flags
+  Expr* diff = intVar(seq, intOp(mkVar(rem), SUB, d));
+  Expr* mask = intVar(seq, intOp(diff, SHR, top));
+  varAssign(seq, always, rem, intOp(diff, ADD, intOp(d, BAND, mask)));
+  varAssign(seq, always, quot,
+    intOp(mkVar(quot), BOR, intOp(mask, ADD, mkIntLit(1))));
+
+  // Decrement counter and loop
+  instr.tag                   = ALU;
+  instr.ALU.setFlags          = true;
+  instr.ALU.cond              = always;
+  instr.ALU.dest              = dstReg(count);
+  instr.ALU.srcA.tag          = REG;
+  instr.ALU.srcA.reg          = srcReg(count);
+  instr.ALU.op                = A_SUB;
+  instr.ALU.srcB.tag          = IMM;
+  instr.ALU.srcB.smallImm.tag = SMALL_IMM;
+  instr.ALU.srcB.smallImm.val = encodeSmallLit(mkIntLit(1));
+  seq->append(instr);
+
+  instr.tag       = BRL;
+  instr.BRL.cond.tag  = COND_ALL;
+  instr.BRL.cond.flag = ZC;
+  instr.BRL.label = loop;
+  seq->append(instr);
+
+  *q = mkVar(quot);
+  *r = mkVar(rem);
+}
+
+Expr* intDivide(Seq<Instr>* seq, Op op, Expr* a, Expr* b)
+{
+  // Magnitude and sign (0 or -1) of dividend
+  Expr* x  = putInVar(seq, a);
+  Expr* sx = intVar(seq, intOp(x, SHR, mkIntLit(31)));
+  Expr* n  = intVar(seq, intOp(intOp(x, BXOR, sx), SUB, sx));
+
+  // Magnitude of result, and sign of quotient
+  bool mod = op.op == MOD;
+  Expr* mag;
+  Expr* sq;
+  if (b->tag == INT_LIT && b->intLit != 0) {
+    int32_t d = b->intLit;
+    mag = divLit(seq, n, d < 0 ? 0 - (uint32_t) d : (uint32_t) d, mod);
+    sq  = d < 0 ? intOp(sx, BNOT, mkIntLit(0)) : sx;
+  }
+  else {
+    Expr* y  = putInVar(seq, b);
+    Expr* sy = intVar(seq, intOp(y, SHR, mkIntLit(31)));
+    Expr* d  = intVar(seq, intOp(intOp(y, BXOR, sy), SUB, sy));
+    Expr* q;
+    Expr* r;
+    divVar(seq, n, d, &q, &r);
+    mag = mod ? r : q;
+    sq  = intOp(sx, BXOR, sy);
+  }
+
+  // Apply sign: (v ^ s) - s negates v when s is -1
+  Expr* s = putInVar(seq, mod ? sx : sq);
+  return intOp(intOp(putInVar(seq, mag), BXOR, s), SUB, s);
+}
+
+// Rounding to half precision, to nearest even, is done on the bits of
+// the magnitude a, selecting one of three results with masks:
+//
+//   normal:      rebias the exponent and round the mantissa
+//   denormal:    a float addition of 0.5 does the rounding
+//   overflow:    infinity, or a quiet NaN
+//
+// The sign is then copied over.  (Must agree with the interpreter.)
+
+Expr* roundHalf(Seq<Instr>* seq, Expr* f)
+{
+  Expr* bits = putInVar(seq, f);
+  Expr* a    = intVar(seq, intOp(bits, BAND, mkIntLit(0x7fffffff)));
+
+  Expr* norm = intOp(intOp(intOp(a, SUB, mkIntLit(0x37fff001)), ADD,
+                           intOp(intOp(a, USHR, mkIntLit(13)), BAND,
+                                 mkIntLit(1))),
+                     USHR, mkIntLit(13));
+  Expr* den  = intOp(mkApply(a, mkOp(ADD, FLOAT), mkFloatLit(0.5)),
+                     SUB, mkIntLit(0x3f000000));
+  Expr* inf  = intOp(intOp(intOp(intOp(mkIntLit(0x7f800000), SUB, a),
+                                 SHR, mkIntLit(31)),
+                           BAND, mkIntLit(0x200)),
+                     BOR, mkIntLit(0x7c00));
+
+  Expr* isDen = intVar(seq, intOp(intOp(a, SUB, mkIntLit(0x38800000)),
+                                  SHR, mkIntLit(31)));
+  Expr* isInf = intVar(seq, intOp(intOp(mkIntLit(0x477fffff), SUB, a),
+                                  SHR, mkIntLit(31)));
+  Expr* isNorm = intOp(intOp(isDen, BOR, isInf), BNOT, mkIntLit(0));
+
+  Expr* o = intOp(intOp(intOp(den, BAND, isDen), BOR,
+                        intOp(norm, BAND, isNorm)),
+                  BOR, intOp(inf, BAND, isInf));
+  Expr* sign = intOp(intOp(bits, USHR, mkIntLit(16)), BAND,
+                     mkIntLit(0x8000));
+  return intVar(seq, intOp(o, BOR, sign));
+}
+
 // ============================================================================
 // Assignment statements
 // ============================================================================
@@ -347,16 +873,9 @@ void assign( Seq<Instr>* seq   // Target instruction sequence to extend
   // Case: *v := rhs where v is a var and rhs is a var
   // -------------------------------------------------
   if (lhs.tag == DEREF) {
+    storeDeref(seq, rhs, lhs.deref.ptr);
     Instr instr;
-    instr.tag        = ST1;
-    instr.ST1.data   = srcReg(rhs->var);
-    instr.ST1.buffer = A;
-    seq->append(instr);
-    instr.tag        = ST2;
-    instr.ST2.addr   = srcReg(lhs.deref.ptr->var);
-    instr.ST2.buffer = A;
-    seq->append(instr);
-    instr.tag        = ST3;
+    instr.tag = ST3;
     seq->append(instr);
     return;
   }
@@ -742,6 +1261,47 @@ BranchCond condExp(Seq<Instr>* seq, CExpr* c)
 // Where statements
 // ============================================================================
 
+// Minimum number of instructions in the body of a 'where' statement
+// for the compiler to branch over it when no lane is active.  The
+// branch costs four cycles, including delay slots, when not taken.
+
+#define WHERE_BRANCH_MIN 12
+
+// Append the instructions of a 'where' body, predicated on 'cond', to
+// 'seq'.  Depending on the hint and the size of the body, precede them
+// by a branch over the body that is taken when 'cond' holds in no
+// lane.  The implicit condition vector must reflect 'cond' on entry.
+
+void whereBody( Seq<Instr>* seq
+              , Seq<Instr>* body
+              , AssignCond cond
+              , WhereHint hint )
+{
+  bool branch = cond.tag == FLAG &&
+    (hint == WHERE_BRANCHY ||
+     (hint == WHERE_AUTO && body->numElems >= WHERE_BRANCH_MIN));
+
+  Instr instr;
+  Label skipLabel;
+  if (branch) {
+    skipLabel            = freshLabel();
+    instr.tag            = BRL;
+    instr.BRL.cond.tag   = COND_ALL;
+    instr.BRL.cond.flag  = negFlag(cond.flag);
+    instr.BRL.label      = skipLabel;
+    seq->append(instr);
+  }
+
+  for (int i = 0; i < body->numElems; i++)
+    seq->append(body->elems[i]);
+
+  if (branch) {
+    instr.tag   = LAB;
+    instr.label = skipLabel;
+    seq->append(instr);
+  }
+}
+
 void whereStmt( Seq<Instr>* seq
               , Stmt* s
               , Var condVar
@@ -759,7 +1319,15 @@ void whereStmt( Seq<Instr>* seq
   // Case: v = e, where v is a variable and e an expression
   // ------------------------------------------------------
   if (s->tag == ASSIGN && s->assign.lhs->tag == VAR) {
-    varAssign(seq, cond, s->assign.lhs->var, s->assign.rhs);
+    Expr* rhs = s->assign.rhs;
+    if (cond.tag != ALWAYS && setsFlags(rhs)) {
+      // Evaluate a selection or a division by a variable in every
+      // lane, and then restore the implicit condition vector that it
+      // overwrites
+      rhs = putInVar(seq, rhs);
+      seq->append(setCond(condVar));
+    }
+    varAssign(seq, cond, s->assign.lhs->var, rhs);
     return;
   }
 
@@ -784,14 +1352,20 @@ void whereStmt( Seq<Instr>* seq
       AssignCond newCond = boolExp(seq, s->where.cond, condVar, true);
 
       // Compile 'then' statement
-      if (s->where.thenStmt != NULL)
-        whereStmt(seq, s->where.thenStmt, condVar, newCond,
+      if (s->where.thenStmt != NULL) {
+        Seq<Instr> body;
+        whereStmt(&body, s->where.thenStmt, condVar, newCond,
           s->where.elseStmt != NULL);
+        whereBody(seq, &body, newCond, s->where.hint);
+      }
 
       // Compile 'else' statement
-      if (s->where.elseStmt != NULL)
-        whereStmt(seq, s->where.elseStmt, condVar,
+      if (s->where.elseStmt != NULL) {
+        Seq<Instr> body;
+        whereStmt(&body, s->where.elseStmt, condVar,
                     negAssignCond(newCond), false);
+        whereBody(seq, &body, negAssignCond(newCond), s->where.hint);
+      }
     }
     else {
       // Save condVar
@@ -808,7 +1382,9 @@ void whereStmt( Seq<Instr>* seq
         AssignCond andCond = boolAnd(seq, cond, condVar, newCond, true);
 
         // Compile 'then' statement
-        whereStmt(seq, s->where.thenStmt, condVar, andCond, false);
+        Seq<Instr> body;
+        whereStmt(&body, s->where.thenStmt, condVar, andCond, false);
+        whereBody(seq, &body, andCond, s->where.hint);
       }
 
       if (saveRestore || s->where.elseStmt != NULL)
@@ -820,7 +1396,9 @@ void whereStmt( Seq<Instr>* seq
                                cond, true);
   
         // Compile 'else' statement
-        whereStmt(seq, s->where.elseStmt, newCondVar, andCond, false);
+        Seq<Instr> body;
+        whereStmt(&body, s->where.elseStmt, newCondVar, andCond, false);
+        whereBody(seq, &body, andCond, s->where.hint);
   
         // Restore condVar and implicit condition vector
         if (saveRestore)
@@ -871,33 +1449,291 @@ void printStmt(Seq<Instr>* seq, PrintStmt s)
   assert(false);
 }
 
+// ============================================================================
+// DMA loads and stores
+// ============================================================================
+
+// DMA pitches are limited to 13 bits.  A stride too large for this is
+// held in its reserved variable as the row pitch in bytes, which is
+// positive, rather than as a DMA setup, which is negative.  Loads and
+// stores then test the sign and fall back to one DMA per lane.  The
+// test is only generated in kernels that set a stride which is not a
+// literal known to fit (see 'translateStmt').
+
+static bool checkReadStride  = false;
+static bool checkWriteStride = false;
+
+static bool fitsReadStride(int stride)  { return (stride+1)*4 < 8192; }
+static bool fitsWriteStride(int stride) { return stride*4 < 8192; }
+
+static Var reservedVar(ReservedVarId id)
+{
+  Var v;
+  v.tag = STANDARD;
+  v.id  = id;
+  return v;
+}
+
+static Reg specialReg(Special id)
+{
+  Reg r;
+  r.tag   = SPECIAL;
+  r.regId = id;
+  return r;
+}
+
+// Append 'dma', or if the stride is checked, append 'dma' and 'split'
+// with a branch to 'split' when the stride held in 'rsv' is too large.
+
+static void strideGuard( Seq<Instr>* seq
+                       , bool check
+                       , ReservedVarId rsv
+                       , Seq<Instr>* dma
+                       , Seq<Instr>* split )
+{
+  Label splitLabel = freshLabel();
+  Label endLabel   = freshLabel();
+  Instr instr;
+
+  if (check) {
+    seq->append(setCond(reservedVar(rsv)));
+    instr.tag           = BRL;
+    instr.BRL.cond.tag  = COND_ALL;
+    instr.BRL.cond.flag = NC;
+    instr.BRL.label     = splitLabel;
+    seq->append(instr);
+  }
+
+  for (int i = 0; i < dma->numElems; i++)
+    seq->append(dma->elems[i]);
+
+  if (check) {
+    instr.tag          = BRL;
+    instr.BRL.cond.tag = COND_ALWAYS;
+    instr.BRL.label    = endLabel;
+    seq->append(instr);
+    instr.tag   = LAB;
+    instr.label = splitLabel;
+    seq->append(instr);
+    for (int i = 0; i < split->numElems; i++)
+      seq->append(split->elems[i]);
+    instr.tag   = LAB;
+    instr.label = endLabel;
+    seq->append(instr);
+  }
+}
+
+// Setup 'base' with VPM row 'row' placed at bit 'shift'.
+
+static Expr* rowSetup(Seq<Instr>* seq, Expr* base, Expr* row, int shift)
+{
+  Expr* r = row->tag == INT_LIT ? mkIntLit(row->intLit << shift) :
+              intOp(row, SHL, mkIntLit(shift));
+  return putInVar(seq, intOp(base, BOR, r));
+}
+
+// VPM row of lane k in a transfer of the first n lanes: lanes from n
+// on repeat lane n-1, which is harmless (n is NULL for all lanes).
+
+static Expr* laneRow(int k, Expr* last)
+{
+  return last == NULL ? mkIntLit(k) : intOp(last, MIN, mkIntLit(k));
+}
+
+// Add the stride to the address of lane k-1 to give that of lane k.
+
+static void nextLaneAddr(Seq<Instr>* seq, Expr* a, int k, Expr* pitch,
+                         Expr* n)
+{
+  AssignCond always;
+  always.tag = ALWAYS;
+  Expr* step = n == NULL ? pitch :
+    intOp(intOp(intOp(mkIntLit(k), SUB, n), SHR, mkIntLit(31)),
+          BAND, pitch);
+  varAssign(seq, always, a->var, intOp(a, ADD, step));
+}
+
+// DMA load of the first n rows (all 16 if n is NULL) at addr into the
+// same lanes of v.  Any other lanes of v are undefined.  With n, the
+// DMA is as generated for LD1 but with NROWS = n (where 0 means 16).
+// The per-lane fallback loads each row into its own row of the VPM.
+
+static void dmaLoad(Seq<Instr>* seq, Var v, Expr* addr, Expr* n)
+{
+  addr = putInVar(seq, addr);
+  if (n != NULL) n = putInVar(seq, n);
+
+  Var qpuNum; qpuNum.tag = QPU_NUM;
+  Instr instr;
+
+  Seq<Instr> dma;
+  if (n == NULL) {
+    instr.tag        = LD1;
+    instr.LD1.addr   = srcReg(addr->var);
+    instr.LD1.buffer = A;
+    dma.append(instr);
+  }
+  else {
+    Expr* rows  = putInVar(&dma, intOp(intOp(n, BAND, mkIntLit(15)),
+                                       SHL, mkIntLit(16)));
+    Expr* setup = putInVar(&dma, intOp(intOp(mkVar(qpuNum), BOR,
+                                             mkIntLit(0x80101800)),
+                                       BOR, rows));
+    Reg rdSetup = specialReg(SPECIAL_RD_SETUP);
+    dma.append(genMove(rdSetup, srcReg(reservedVar(RSV_READ_STRIDE))));
+    dma.append(genMove(rdSetup, srcReg(setup->var)));
+    dma.append(genMove(specialReg(SPECIAL_DMA_LD_ADDR), srcReg(addr->var)));
+  }
+  instr.tag = LD2;
+  dma.append(instr);
+
+  Seq<Instr> split;
+  if (checkReadStride) {
+    Expr* pitch = mkVar(reservedVar(RSV_READ_STRIDE));
+    Expr* last  = n == NULL ? NULL : putInVar(&split, intOp(n, SUB,
+                                                            mkIntLit(1)));
+    Expr* base  = putInVar(&split, intOp(mkVar(qpuNum), BOR,
+                                         mkIntLit(0x80111800)));
+    Expr* a     = intVar(&split, addr);
+    for (int k = 0; k < NUM_LANES; k++) {
+      // One row, vertical, VPM row k of the QPU's column
+      if (k > 0) nextLaneAddr(&split, a, k, pitch, n);
+      Expr* setup = rowSetup(&split, base, laneRow(k, last), 4);
+      split.append(genMove(specialReg(SPECIAL_RD_SETUP),
+                           srcReg(setup->var)));
+      split.append(genMove(specialReg(SPECIAL_DMA_LD_ADDR),
+                           srcReg(a->var)));
+      instr.tag = LD2;
+      split.append(instr);
+    }
+  }
+
+  strideGuard(seq, checkReadStride, RSV_READ_STRIDE, &dma, &split);
+
+  instr.tag        = LD3;
+  instr.LD3.buffer = A;
+  seq->append(instr);
+  instr.tag        = LD4;
+  instr.LD4.dest   = dstReg(v);
+  seq->append(instr);
+}
+
+void loadDeref(Seq<Instr>* seq, Var v, Expr* addr)
+{
+  dmaLoad(seq, v, addr, NULL);
+}
+
+// Start a DMA store of the first n rows (all 16 if n is NULL) of the
+// VPM vector written by ST1 to addr.  With n, the DMA is as generated
+// for ST2 but with UNITS = n.  The per-lane fallback waits for each
+// one-word store before starting the next.
+
+static void dmaStore(Seq<Instr>* seq, Expr* addr, Expr* n)
+{
+  addr = putInVar(seq, addr);
+  if (n != NULL) n = putInVar(seq, n);
+
+  Var qpuNum; qpuNum.tag = QPU_NUM;
+  Expr* col = intOp(mkVar(qpuNum), SHL, mkIntLit(3));
+  Reg wrSetup = specialReg(SPECIAL_WR_SETUP);
+  Reg stAddr  = specialReg(SPECIAL_DMA_ST_ADDR);
+  Instr instr;
+
+  Seq<Instr> dma;
+  if (n == NULL) {
+    instr.tag        = ST2;
+    instr.ST2.addr   = srcReg(addr->var);
+    instr.ST2.buffer = A;
+    dma.append(instr);
+  }
+  else {
+    Expr* units = putInVar(&dma, intOp(n, SHL, mkIntLit(23)));
+    Expr* setup = putInVar(&dma, intOp(intOp(putInVar(&dma, col), BOR,
+                                             mkIntLit(0x80014000 | (32 << 7))),
+                                       BOR, units));
+    dma.append(genMove(wrSetup, srcReg(reservedVar(RSV_WRITE_STRIDE))));
+    dma.append(genMove(wrSetup, srcReg(setup->var)));
+    dma.append(genMove(stAddr, srcReg(addr->var)));
+  }
+
+  Seq<Instr> split;
+  if (checkWriteStride) {
+    Expr* pitch = mkVar(reservedVar(RSV_WRITE_STRIDE));
+    Expr* last  = n == NULL ? NULL : putInVar(&split, intOp(n, SUB,
+                                                            mkIntLit(1)));
+    Expr* base  = putInVar(&split, intOp(putInVar(&split, col), BOR,
+                                         mkIntLit(0x80814000 | (32 << 7))));
+    Expr* a     = intVar(&split, addr);
+    for (int k = 0; k < NUM_LANES; k++) {
+      // One unit of depth one, horizontal, VPM row 32+k
+      if (k > 0) {
+        nextLaneAddr(&split, a, k, pitch, n);
+        instr.tag = ST3;
+        split.append(instr);
+      }
+      Expr* setup = rowSetup(&split, base, laneRow(k, last), 7);
+      split.append(genMove(wrSetup, srcReg(setup->var)));
+      split.append(genMove(stAddr, srcReg(a->var)));
+    }
+  }
+
+  strideGuard(seq, checkWriteStride, RSV_WRITE_STRIDE, &dma, &split);
+}
+
+void storeDeref(Seq<Instr>* seq, Expr* data, Expr* addr)
+{
+  Instr instr;
+  instr.tag        = ST1;
+  instr.ST1.data   = srcReg(data->var);
+  instr.ST1.buffer = A;
+  seq->append(instr);
+  dmaStore(seq, addr, NULL);
+}
+
 // ============================================================================
 // Set-stride statements
 // ============================================================================
 
+// A stride that may be too large for DMA is held as the row pitch in
+// bytes if it is (see 'DMA loads and stores').
+
 void setStrideStmt(Seq<Instr>* seq, StmtTag tag, Expr* e)
 {
-  if (e->tag == INT_LIT) {
-    if (tag == SET_READ_STRIDE)
+  bool read = tag == SET_READ_STRIDE;
+  if (e->tag == INT_LIT &&
+        (read ? fitsReadStride(e->intLit) : fitsWriteStride(e->intLit))) {
+    if (read)
       genSetReadStride(seq, e->intLit);
     else
       genSetWriteStride(seq, e->intLit);
+    return;
   }
-  else if (e->tag == VAR) {
-    if (tag == SET_READ_STRIDE)
-      genSetReadStride(seq, srcReg(e->var));
-    else
-      genSetWriteStride(seq, srcReg(e->var));
+
+  AssignCond always;
+  always.tag = ALWAYS;
+  Var rsv = reservedVar(read ? RSV_READ_STRIDE : RSV_WRITE_STRIDE);
+  if (e->tag == INT_LIT) {
+    varAssign(seq, always, rsv, mkIntLit((e->intLit+1)*4));
+    return;
+  }
+
+  // Select the setup or the pitch without branching: 'fits' is -1 if
+  // the stride fits and 0 otherwise
+  Expr* pitch = intVar(seq, intOp(intOp(e, ADD, mkIntLit(1)),
+                                  SHL, mkIntLit(2)));
+  if (read) {
+    Expr* fits = intOp(intOp(pitch, SUB, mkIntLit(8192)),
+                       SHR, mkIntLit(31));
+    varAssign(seq, always, rsv,
+      intOp(pitch, BOR, intOp(putInVar(seq, fits), BAND,
+                              mkIntLit(0x90000000))));
   }
   else {
-    AssignCond always;
-    always.tag = ALWAYS;
-    Var v = freshVar();
-    varAssign(seq, always, v, e);
-    if (tag == SET_READ_STRIDE)
-      genSetReadStride(seq, srcReg(v));
-    else
-      genSetWriteStride(seq, srcReg(v));
+    Expr* fits = putInVar(seq, intOp(intOp(pitch, SUB, mkIntLit(8196)),
+                                     SHR, mkIntLit(31)));
+    varAssign(seq, always, rsv,
+      intOp(intOp(pitch, SUB, intOp(fits, BAND, mkIntLit(4))), BOR,
+            intOp(fits, BAND, mkIntLit(0xc0010000))));
   }
 }
 
@@ -914,6 +1750,19 @@ void loadReceive(Seq<Instr>* seq, Expr* dest)
   seq->append(instr);
 }
 
+// ============================================================================
+// Partial load
+// ============================================================================
+
+// Load the first 'count' elements (between 1 and 16) at addr into
+// the same lanes of dest.  The remaining lanes of dest are undefined.
+
+void loadPartial(Seq<Instr>* seq, Expr* dest, Expr* addr, Expr* count)
+{
+  assert(dest->tag == VAR);
+  dmaLoad(seq, dest->var, addr, count);
+}
+
 // ============================================================================
 // Store request
 // ============================================================================
@@ -922,9 +1771,10 @@ void loadReceive(Seq<Instr>* seq, Expr* dest)
 // *addr = data.  The difference is that a 'store' waits until
 // outstanding DMAs have completed before performing a write rather
 // than after a write.  This enables other operations to happen in
-// parallel with the write.
+// parallel with the write.  If 'count' is not NULL, only the first
+// 'count' elements (between 1 and 16) are written.
 
-void storeRequest(Seq<Instr>* seq, Expr* data, Expr* addr)
+void storeRequest(Seq<Instr>* seq, Expr* data, Expr* addr, Expr* count)
 {
   if (data->tag != VAR || addr->tag != VAR) {
     data = putInVar(seq, data);
@@ -938,10 +1788,155 @@ void storeRequest(Seq<Instr>* seq, Expr* data, Expr* addr)
   instr.ST1.data   = srcReg(data->var);
   instr.ST1.buffer = A;
   seq->append(instr);
-  instr.tag        = ST2;
-  instr.ST2.addr   = srcReg(addr->var);
-  instr.ST2.buffer = A;
+  dmaStore(seq, addr, count);
+}
+
+// ============================================================================
+// Scatter
+// ============================================================================
+
+// The data vector is written to the VPM once and then each lane is
+// sent to its own address by a one-word DMA store.  The DMA setup
+// selects the VPM row of the lane (and the column of the QPU) and
+// each DMA waits for the previous one.  Lane k's address is brought
+// into lane 0 by a rotate, since the DMA address is taken from there.
+
+void scatter(Seq<Instr>* seq, Expr* data, Expr* addr)
+{
+  data = putInVar(seq, data);
+  addr = putInVar(seq, addr);
+
+  Instr instr;
+  instr.tag        = ST3;
+  seq->append(instr);
+  instr.tag        = ST1;
+  instr.ST1.data   = srcReg(data->var);
+  instr.ST1.buffer = A;
   seq->append(instr);
+
+  Var qpuNum; qpuNum.tag = QPU_NUM;
+  Expr* col  = putInVar(seq, intOp(mkVar(qpuNum), SHL, mkIntLit(3)));
+  Expr* base = putInVar(seq, intOp(col, BOR,
+                                   mkIntLit(0x80814000 | (32 << 7))));
+
+  for (int k = 0; k < NUM_LANES; k++) {
+    // One unit of depth one, horizontal, VPM row 32+k
+    Expr* setup = rowSetup(seq, base, mkIntLit(k), 7);
+    Expr* a = k == 0 ? addr :
+      putInVar(seq, intOp(addr, ROTATE, mkIntLit(NUM_LANES-k)));
+    if (k > 0) {
+      instr.tag = ST3;
+      seq->append(instr);
+    }
+    seq->append(genMove(specialReg(SPECIAL_WR_SETUP), srcReg(setup->var)));
+    seq->append(genMove(specialReg(SPECIAL_DMA_ST_ADDR), srcReg(a->var)));
+  }
+}
+
+// ============================================================================
+// Shared access
+// ============================================================================
+
+// Vectors 0 to 15 of the scratchpad are the 16 columns of VPM rows
+// 16 to 31 (the B load buffers) and vectors 16 to 31 are those of
+// rows 48 to 63 (the B store buffers).  Return the VPM address, in
+// the form used by VPM setups, of the vector k.
+
+static Expr* sharedAddr(Seq<Instr>* seq, Expr* k)
+{
+  return putInVar(seq, intOp(intOp(k, ADD, mkIntLit(16)), ADD,
+                             intOp(k, BAND, mkIntLit(16))));
+}
+
+void sharedAccess(Seq<Instr>* seq, Stmt* s)
+{
+  Expr* k = intVar(seq, s->shared.index);
+  Var qpuNum; qpuNum.tag = QPU_NUM;
+  Reg rdSetup = specialReg(SPECIAL_RD_SETUP);
+  Reg wrSetup = specialReg(SPECIAL_WR_SETUP);
+  Instr instr;
+
+  switch (s->shared.op) {
+    // Vertical VPM read of the vector's column, as for LD3
+    case SHARED_READ: {
+      Expr* setup = putInVar(seq, intOp(sharedAddr(seq, k), BOR,
+                                        mkIntLit(0x00100200)));
+      seq->append(genMove(rdSetup, srcReg(setup->var)));
+      for (int i = 0; i < 3; i++)
+        seq->append(nop());
+      instr.tag       = LD4;
+      instr.LD4.dest  = dstReg(s->shared.data->var);
+      seq->append(instr);
+      return;
+    }
+
+    // Vertical VPM write, then restore the setup for ST1
+    case SHARED_WRITE: {
+      Expr* data  = putInVar(seq, s->shared.data);
+      Expr* setup = putInVar(seq, intOp(sharedAddr(seq, k), BOR,
+                                        mkIntLit(0x00100200)));
+      Expr* store = putInVar(seq, intOp(mkVar(qpuNum), BOR,
+                                        mkIntLit(0x00100220)));
+      seq->append(genMove(wrSetup, srcReg(setup->var)));
+      instr.tag        = ST1;
+      instr.ST1.data   = srcReg(data->var);
+      instr.ST1.buffer = A;
+      seq->append(instr);
+      seq->append(genMove(wrSetup, srcReg(store->var)));
+      return;
+    }
+
+    // One DMA per vector, with a memory pitch of one word
+    case SHARED_LOAD: {
+      Expr* a = intVar(seq, s->shared.addr);
+      seq->append(genMove(rdSetup, srcReg(
+                    putInVar(seq, mkIntLit(0x90000004))->var)));
+      for (int i = 0; i < s->shared.count; i++) {
+        if (i > 0) {
+          AssignCond always;
+          always.tag = ALWAYS;
+          varAssign(seq, always, k->var, intOp(k, ADD, mkIntLit(1)));
+          varAssign(seq, always, a->var, intOp(a, ADD, mkIntLit(64)));
+        }
+        Expr* v = sharedAddr(seq, k);
+        Expr* setup = putInVar(seq, intOp(intOp(
+                        intOp(intOp(v, BAND, mkIntLit(0x30)), SHL, mkIntLit(4)),
+                        BOR, intOp(v, BAND, mkIntLit(15))),
+                        BOR, mkIntLit(0x80101800)));
+        seq->append(genMove(rdSetup, srcReg(setup->var)));
+        seq->append(genMove(specialReg(SPECIAL_DMA_LD_ADDR), srcReg(a->var)));
+        instr.tag = LD2;
+        seq->append(instr);
+      }
+      return;
+    }
+
+    // One DMA per vector, each waiting for the previous one
+    case SHARED_STORE: {
+      Expr* a = intVar(seq, s->shared.addr);
+      instr.tag = ST3;
+      seq->append(instr);
+      seq->append(genMove(wrSetup, srcReg(
+                    putInVar(seq, mkIntLit(0xc0010000))->var)));
+      for (int i = 0; i < s->shared.count; i++) {
+        if (i > 0) {
+          AssignCond always;
+          always.tag = ALWAYS;
+          varAssign(seq, always, k->var, intOp(k, ADD, mkIntLit(1)));
+          varAssign(seq, always, a->var, intOp(a, ADD, mkIntLit(64)));
+        }
+        Expr* v = sharedAddr(seq, k);
+        Expr* setup = putInVar(seq, intOp(intOp(
+                        intOp(intOp(v, BAND, mkIntLit(0x30)), SHL, mkIntLit(7)),
+                        BOR, intOp(intOp(v, BAND, mkIntLit(15)), SHL, mkIntLit(3))),
+                        BOR, mkIntLit(0x88014000)));
+        seq->append(genMove(wrSetup, srcReg(setup->var)));
+        seq->append(genMove(specialReg(SPECIAL_DMA_ST_ADDR), srcReg(a->var)));
+        seq->append(instr);
+      }
+      return;
+    }
+  }
 }
 
 // ============================================================================
@@ -1117,11 +2112,36 @@ void stmt(Seq<Instr>* seq, Stmt* s)
     return;
   }
 
+  // ------------------------------------------------
+  // Case: v = load(e0, e1) where e0 and e1 are exprs
+  // ------------------------------------------------
+  if (s->tag == LOAD_PARTIAL) {
+    loadPartial(seq, s->loadReq.dest, s->loadReq.addr, s->loadReq.count);
+    return;
+  }
+
   // ---------------------------------------------
   // Case: store(e0, e1) where e1 and e2 are exprs
   // ---------------------------------------------
   if (s->tag == STORE_REQUEST) {
-    storeRequest(seq, s->storeReq.data, s->storeReq.addr);
+    storeRequest(seq, s->storeReq.data, s->storeReq.addr,
+                 s->storeReq.count);
+    return;
+  }
+
+  // -----------------------------------------------
+  // Case: scatter(e0, e1) where e0 and e1 are exprs
+  // -----------------------------------------------
+  if (s->tag == SCATTER) {
+    scatter(seq, s->storeReq.data, s->storeReq.addr);
+    return;
+  }
+
+  // ---------------------------------------
+  // Case: access to the shared scratchpad
+  // ---------------------------------------
+  if (s->tag == SHARED) {
+    sharedAccess(seq, s);
     return;
   }
 
@@ -1172,10 +2192,46 @@ void insertEndCode(Seq<Instr>* seq)
 // Interface
 // ============================================================================
 
+// Decide whether loads and stores must test the stride, i.e. whether
+// any stride set is not a literal known to fit.
+
+static void scanStrides(Stmt* s)
+{
+  if (s == NULL) return;
+  switch (s->tag) {
+    case SEQ:
+      scanStrides(s->seq.s0);
+      scanStrides(s->seq.s1);
+      return;
+    case WHERE:
+      scanStrides(s->where.thenStmt);
+      scanStrides(s->where.elseStmt);
+      return;
+    case IF:
+      scanStrides(s->ifElse.thenStmt);
+      scanStrides(s->ifElse.elseStmt);
+      return;
+    case WHILE:
+      scanStrides(s->loop.body);
+      return;
+    case SET_READ_STRIDE:
+      if (s->stride->tag != INT_LIT || !fitsReadStride(s->stride->intLit))
+        checkReadStride = true;
+      return;
+    case SET_WRITE_STRIDE:
+      if (s->stride->tag != INT_LIT || !fitsWriteStride(s->stride->intLit))
+        checkWriteStride = true;
+      return;
+  }
+}
+
 // Top-level translation function for statements.
 
 void translateStmt(Seq<Instr>* seq, Stmt* s)
 {
+  checkReadStride  = false;
+  checkWriteStride = false;
+  scanStrides(s);
   stmt(seq, s);
   insertEndCode(seq);
 }
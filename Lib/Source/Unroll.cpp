@@ -0,0 +1,407 @@
+#include <assert.h>
+#include "Source/Unroll.h"
+
+// ============================================================================
+// Loop unrolling
+// ============================================================================
+
+// A 'For' loop of the form
+//
+//   for (; i < e; i = i + s) body
+//
+// is unrolled by a factor of n into a main loop, whose condition
+// checks that at least n iterations remain, followed by an epilogue
+// performing any remaining iterations:
+//
+//   while (i + (n-1)*s < e) { body; i = i + s; ... body; i = i + s; }
+//   while (i < e) { body; i = i + s; }
+//
+// where either condition may be reduced using 'any' or 'all'.  This is
+// valid provided the body does not modify i, s or e, and the step
+// moves i towards e: increasing for < and <=, decreasing for > and >=.
+// A variable step s is assumed to be positive.
+//
+// Variables local to the body are renamed in each copy, so that the
+// live ranges of the copies are independent.
+
+// ============================================================================
+// Copying with renaming
+// ============================================================================
+
+struct Renaming {
+  VarId  first;   // Id of first local variable
+  int    num;     // Number of local variables
+  VarId* to;      // New id of each local variable (NULL for no renaming)
+};
+
+static Var renameVar(Renaming* r, Var v)
+{
+  if (r->to != NULL && v.tag == STANDARD &&
+      v.id >= r->first && v.id < r->first + r->num)
+    v.id = r->to[v.id - r->first];
+  return v;
+}
+
+static BExpr* copyBExpr(Renaming* r, BExpr* b);
+
+static Expr* copyExpr(Renaming* r, Expr* e)
+{
+  if (e == NULL) return NULL;
+  switch (e->tag) {
+    case INT_LIT:   return mkIntLit(e->intLit);
+    case FLOAT_LIT: return mkFloatLit(e->floatLit);
+    case VAR:       return mkVar(renameVar(r, e->var));
+    case APPLY:     return mkApply(copyExpr(r, e->apply.lhs), e->apply.op,
+                                   copyExpr(r, e->apply.rhs));
+    case DEREF:     return mkDeref(copyExpr(r, e->deref.ptr));
+    case SELECT:    return mkSelect(copyBExpr(r, e->select.cond),
+                                    copyExpr(r, e->select.lhs),
+                                    copyExpr(r, e->select.rhs));
+  }
+
+  // Not reachable
+  assert(false);
+}
+
+static BExpr* copyBExpr(Renaming* r, BExpr* b)
+{
+  switch (b->tag) {
+    case NOT: return mkNot(copyBExpr(r, b->neg));
+    case AND: return mkAnd(copyBExpr(r, b->conj.lhs),
+                           copyBExpr(r, b->conj.rhs));
+    case OR:  return mkOr(copyBExpr(r, b->disj.lhs),
+                          copyBExpr(r, b->disj.rhs));
+    case CMP: return mkCmp(copyExpr(r, b->cmp.lhs), b->cmp.op,
+                           copyExpr(r, b->cmp.rhs));
+  }
+
+  // Not reachable
+  assert(false);
+}
+
+static CExpr* copyCExpr(Renaming* r, CExpr* c)
+{
+  BExpr* b = copyBExpr(r, c->bexpr);
+  return c->tag == ALL ? mkAll(b) : mkAny(b);
+}
+
+static Stmt* copyStmt(Renaming* r, Stmt* s)
+{
+  if (s == NULL) return NULL;
+
+  // Copy tag and any scalar fields
+  Stmt* t = mkStmt();
+  *t = *s;
+
+  switch (s->tag) {
+    case SKIP:
+    case FLUSH:
+    case SEND_IRQ_TO_HOST:
+    case SEMA_INC:
+    case SEMA_DEC:
+      return t;
+    case ASSIGN:
+      t->assign.lhs = copyExpr(r, s->assign.lhs);
+      t->assign.rhs = copyExpr(r, s->assign.rhs);
+      return t;
+    case SEQ:
+      t->seq.s0 = copyStmt(r, s->seq.s0);
+      t->seq.s1 = copyStmt(r, s->seq.s1);
+      return t;
+    case WHERE:
+      t->where.cond     = copyBExpr(r, s->where.cond);
+      t->where.thenStmt = copyStmt(r, s->where.thenStmt);
+      t->where.elseStmt = copyStmt(r, s->where.elseStmt);
+      return t;
+    case IF:
+      t->ifElse.cond     = copyCExpr(r, s->ifElse.cond);
+      t->ifElse.thenStmt = copyStmt(r, s->ifElse.thenStmt);
+      t->ifElse.elseStmt = copyStmt(r, s->ifElse.elseStmt);
+      return t;
+    case WHILE:
+      t->loop.cond = copyCExpr(r, s->loop.cond);
+      t->loop.body = copyStmt(r, s->loop.body);
+      return t;
+    case FOR:
+      t->forLoop.cond = copyCExpr(r, s->forLoop.cond);
+      t->forLoop.inc  = copyStmt(r, s->forLoop.inc);
+      t->forLoop.body = copyStmt(r, s->forLoop.body);
+      return t;
+    case PRINT:
+      if (s->print.tag != PRINT_STR)
+        t->print.expr = copyExpr(r, s->print.expr);
+      return t;
+    case SET_READ_STRIDE:
+    case SET_WRITE_STRIDE:
+      t->stride = copyExpr(r, s->stride);
+      return t;
+    case LOAD_RECEIVE:
+      t->loadDest = copyExpr(r, s->loadDest);
+      return t;
+    case LOAD_PARTIAL:
+      t->loadReq.dest  = copyExpr(r, s->loadReq.dest);
+      t->loadReq.addr  = copyExpr(r, s->loadReq.addr);
+      t->loadReq.count = copyExpr(r, s->loadReq.count);
+      return t;
+    case SHARED:
+      t->shared.index = copyExpr(r, s->shared.index);
+      t->shared.data  = copyExpr(r, s->shared.data);
+      t->shared.addr  = copyExpr(r, s->shared.addr);
+      return t;
+    case STORE_REQUEST:
+    case SCATTER:
+      t->storeReq.data  = copyExpr(r, s->storeReq.data);
+      t->storeReq.addr  = copyExpr(r, s->storeReq.addr);
+      t->storeReq.count = copyExpr(r, s->storeReq.count);
+      return t;
+  }
+
+  // Not reachable
+  assert(false);
+}
+
+// ============================================================================
+// Loop analysis
+// ============================================================================
+
+// Does the statement assign to the given variable?
+
+static bool isVar(Expr* e, Var v)
+{
+  return e != NULL && e->tag == VAR && e->var.tag == v.tag &&
+         e->var.id == v.id;
+}
+
+static bool assigns(Stmt* s, Var v)
+{
+  if (s == NULL) return false;
+  switch (s->tag) {
+    case ASSIGN:       return isVar(s->assign.lhs, v);
+    case LOAD_RECEIVE: return isVar(s->loadDest, v);
+    case LOAD_PARTIAL: return isVar(s->loadReq.dest, v);
+    case SHARED:       return s->shared.op == SHARED_READ &&
+                              isVar(s->shared.data, v);
+    case SEQ:          return assigns(s->seq.s0, v) ||
+                              assigns(s->seq.s1, v);
+    case WHERE:        return assigns(s->where.thenStmt, v) ||
+                              assigns(s->where.elseStmt, v);
+    case IF:           return assigns(s->ifElse.thenStmt, v) ||
+                              assigns(s->ifElse.elseStmt, v);
+    case WHILE:        return assigns(s->loop.body, v);
+    case FOR:          return assigns(s->forLoop.inc, v) ||
+                              assigns(s->forLoop.body, v);
+  }
+  return false;
+}
+
+// Is the value of the expression unaffected by executing the body?
+
+static bool invariant(Expr* e, Stmt* body)
+{
+  if (e == NULL) return true;
+  switch (e->tag) {
+    case INT_LIT:
+    case FLOAT_LIT:
+      return true;
+    case VAR:
+      if (e->var.tag == QPU_NUM || e->var.tag == ELEM_NUM) return true;
+      return e->var.tag == STANDARD && !assigns(body, e->var);
+    case APPLY:
+      return invariant(e->apply.lhs, body) && invariant(e->apply.rhs, body);
+    case DEREF:
+      return false;
+  }
+  return false;
+}
+
+// Rough estimate of the number of QPU instructions generated for an
+// expression or statement.
+
+static int opSize(Op op)
+{
+  if (op.type != FLOAT && (op.op == DIV || op.op == MOD)) return 24;
+  if (op.op == DIV)  return 5 + 3*op.prec;
+  if (op.op == SQRT) return 7 + 5*op.prec + (op.prec > 0);
+  if (isReduce(op)) return 12;
+  return isSFU(op) ? 4 : 1;
+}
+
+static int bexprSize(BExpr* b);
+
+static int exprSize(Expr* e)
+{
+  if (e == NULL) return 0;
+  switch (e->tag) {
+    case INT_LIT:
+    case FLOAT_LIT: return 1;
+    case VAR:       return 0;
+    case APPLY:     return opSize(e->apply.op) +
+                           exprSize(e->apply.lhs) +
+                           exprSize(e->apply.rhs);
+    case DEREF:     return 8 + exprSize(e->deref.ptr);
+    case SELECT:    return 2 + bexprSize(e->select.cond) +
+                           exprSize(e->select.lhs) +
+                           exprSize(e->select.rhs);
+  }
+  return 0;
+}
+
+static int bexprSize(BExpr* b)
+{
+  switch (b->tag) {
+    case NOT: return bexprSize(b->neg);
+    case AND: return 2 + bexprSize(b->conj.lhs) + bexprSize(b->conj.rhs);
+    case OR:  return 2 + bexprSize(b->disj.lhs) + bexprSize(b->disj.rhs);
+    case CMP: return 1 + exprSize(b->cmp.lhs) + exprSize(b->cmp.rhs);
+  }
+  return 0;
+}
+
+static int stmtSize(Stmt* s)
+{
+  if (s == NULL) return 0;
+  switch (s->tag) {
+    case SKIP:   return 0;
+    case ASSIGN: return 1 + exprSize(s->assign.rhs) +
+                   (s->assign.lhs->tag == DEREF ?
+                      8 + exprSize(s->assign.lhs->deref.ptr) : 0);
+    case SEQ:    return stmtSize(s->seq.s0) + stmtSize(s->seq.s1);
+    case WHERE:  return 3 + bexprSize(s->where.cond) +
+                   stmtSize(s->where.thenStmt) + stmtSize(s->where.elseStmt);
+    case IF:     return 8 + bexprSize(s->ifElse.cond->bexpr) +
+                   stmtSize(s->ifElse.thenStmt) +
+                   stmtSize(s->ifElse.elseStmt);
+    case WHILE:  return 8 + bexprSize(s->loop.cond->bexpr) +
+                   stmtSize(s->loop.body);
+    case SCATTER: return 64;
+  }
+  return 4;
+}
+
+// ============================================================================
+// Interface
+// ============================================================================
+
+static CmpOpId flipCmp(CmpOpId op)
+{
+  switch (op) {
+    case LT: return GT;
+    case GT: return LT;
+    case LE: return GE;
+    case GE: return LE;
+  }
+  return op;
+}
+
+Stmt* unrollFor(CExpr* cond, Stmt* inc, Stmt* body,
+                int factor, VarId firstLocal)
+{
+  // Match increment 'i = ...', ignoring any leading 'skip'
+  while (inc != NULL && inc->tag == SEQ && inc->seq.s0->tag == SKIP)
+    inc = inc->seq.s1;
+  if (inc == NULL || inc->tag != ASSIGN) return NULL;
+  Expr* i = inc->assign.lhs;
+  if (i->tag != VAR || i->var.tag != STANDARD) return NULL;
+
+  // Match condition 'i op e' or 'e op i'
+  BExpr* b = cond->bexpr;
+  if (b->tag != CMP || b->cmp.op.type != INT32) return NULL;
+  Expr* e;
+  CmpOpId op = b->cmp.op.op;
+  if (isVar(b->cmp.lhs, i->var)) e = b->cmp.rhs;
+  else if (isVar(b->cmp.rhs, i->var)) {
+    e = b->cmp.lhs;
+    op = flipCmp(op);
+  }
+  else return NULL;
+
+  // Match increment 'i = i + s' or 'i = i - s'
+  Expr* rhs = inc->assign.rhs;
+  if (rhs->tag != APPLY || !isVar(rhs->apply.lhs, i->var)) return NULL;
+  Op stepOp = rhs->apply.op;
+  if (stepOp.op != ADD && stepOp.op != SUB) return NULL;
+  Expr* s = rhs->apply.rhs;
+  bool up;
+  if (s->tag == INT_LIT && s->intLit != 0)
+    up = (stepOp.op == ADD) == (s->intLit > 0);
+  else if (s->tag == VAR && s->var.tag == STANDARD)
+    up = stepOp.op == ADD;
+  else
+    return NULL;
+
+  // Step must move towards the bound
+  if (up && op != LT && op != LE) return NULL;
+  if (!up && op != GT && op != GE) return NULL;
+
+  // Body must not modify i, and neither body nor increment may modify
+  // s or e
+  if (assigns(body, i->var) || !invariant(s, body) || !invariant(e, body) ||
+      !invariant(s, inc) || !invariant(e, inc))
+    return NULL;
+
+  // Limit the size of the unrolled body
+  int size = stmtSize(body) + stmtSize(inc);
+  if (size > 0 && factor * size > UNROLL_MAX_INSTRS)
+    factor = UNROLL_MAX_INSTRS / size;
+  if (factor < 2) return NULL;
+
+  // Distance covered by n-1 steps.  For a variable step, this is
+  // computed before the loop by shifts and adds, as the multiplier
+  // only takes 24 bits.
+  Expr* ahead = NULL;
+  Expr* sum   = NULL;
+  if (s->tag == INT_LIT) {
+    int64_t d = (int64_t) (factor-1) * s->intLit;
+    if (d != (int32_t) d) return NULL;
+    ahead = mkIntLit((int32_t) d);
+  }
+  else {
+    for (int b = 0; (1 << b) <= factor-1; b++) {
+      if (((factor-1) >> b & 1) == 0) continue;
+      Expr* t = b == 0 ? mkVar(s->var)
+              : mkApply(mkVar(s->var), mkOp(SHL, INT32), mkIntLit(b));
+      sum = sum == NULL ? t : mkApply(sum, mkOp(ADD, INT32), t);
+    }
+  }
+
+  // Main loop consists of the original body followed by n-1 copies,
+  // and the epilogue of one more copy, each with fresh local variables
+  Renaming none;
+  none.first = firstLocal; none.num = 0; none.to = NULL;
+  Renaming fresh;
+  fresh.first = firstLocal;
+  fresh.num   = getFreshVarCount() - firstLocal;
+  fresh.to    = new VarId [fresh.num > 0 ? fresh.num : 1];
+
+  Stmt* mainBody = mkSeq(body, inc);
+  Stmt* lastCopy = NULL;
+  for (int k = 1; k <= factor; k++) {
+    for (int j = 0; j < fresh.num; j++) fresh.to[j] = freshVar().id;
+    Stmt* copy = mkSeq(copyStmt(&fresh, body), copyStmt(&none, inc));
+    if (k < factor) mainBody = mkSeq(mainBody, copy);
+    else lastCopy = copy;
+  }
+
+  delete [] fresh.to;
+
+  Stmt* aheadInit = mkSkip();
+  if (sum != NULL) {
+    ahead = mkVar(freshVar());
+    aheadInit = mkAssign(ahead, sum);
+  }
+
+  // Condition of main loop: 'i op e && i +/- (n-1)*s op e'.  Integer
+  // comparisons take the sign of the difference (as the interpreter
+  // notes), so i +/- (n-1)*s alone would pass wherever its difference
+  // from e wraps round, e.g. for i just below INT_MAX and e zero.
+  // Given that i op e, the second difference cannot wrap.
+  BExpr* mainB = mkAnd(
+    copyBExpr(&none, cond->bexpr),
+    mkCmp(mkApply(mkVar(i->var), stepOp, ahead),
+          mkCmpOp(op, INT32), copyExpr(&none, e)));
+  CExpr* mainCond = cond->tag == ALL ? mkAll(mainB) : mkAny(mainB);
+
+  Stmt* mainLoop = mkWhile(mainCond, mainBody);
+  Stmt* epilogue = mkWhile(copyCExpr(&none, cond), lastCopy);
+  return mkSeq(aheadInit, mkSeq(mainLoop, epilogue));
+}
@@ -0,0 +1,18 @@
+#ifndef _SOURCE_UNROLL_H_
+#define _SOURCE_UNROLL_H_
+
+#include "Source/Syntax.h"
+
+// Maximum estimated size, in QPU instructions, of an unrolled loop
+// body.  Each QPU slice has a 4 KB instruction cache, i.e. room for
+// 512 instructions, which the unrolled loop should not monopolise.
+#define UNROLL_MAX_INSTRS 256
+
+// Unroll the loop 'for (; cond; inc) body' by the given factor.
+// Variables with ids from 'firstLocal' onwards are local to the body
+// and are renamed in each copy.  Returns NULL if the loop does not
+// have the required form, in which case it should not be unrolled.
+Stmt* unrollFor(CExpr* cond, Stmt* inc, Stmt* body,
+                int factor, VarId firstLocal);
+
+#endif
@@ -15,6 +15,29 @@
 uint32_t emuHeapEnd = 0;
 int32_t* emuHeap    = NULL;
 
+// Words of the heap at byte address a.  A kernel started by
+// 'Kernel::start' is emulated on its own thread while the host polls
+// and updates shared words (e.g. of a 'WorkQueue'), so these accesses
+// are atomic.
+
+static int32_t heapLoad(uint32_t a)
+{
+  return __atomic_load_n(&emuHeap[a>>2], __ATOMIC_SEQ_CST);
+}
+
+static void heapStore(uint32_t a, int32_t x)
+{
+  __atomic_store_n(&emuHeap[a>>2], x, __ATOMIC_SEQ_CST);
+}
+
+// Address in the emulated VPM of word y of a column x, where each of
+// the four 16-row blocks of the 64x16 VPM holds a vector per column.
+
+static int vpmAddr(int y, int x)
+{
+  return NUM_LANES*(4*x + ((y >> 4) & 3)) + (y & 15);
+}
+
 // ============================================================================
 // Read a vector register
 // ============================================================================
@@ -176,13 +199,19 @@ void writeReg(QPUState* s, bool setFlags, AssignCond cond, Reg dest, Vec v)
             // Initiate VPM load
             VPMLoadQueue* q = &s->vpmLoadQueue;
             assert((q->back+1)%3 != q->front); // Assert not full
-            BufferAorB buffer = A;
-            q->addrs[q->back] = NUM_LANES*(4*s->id + (buffer == A ? 0 : 1));
+            q->addrs[q->back] = vpmAddr(setup & 0x30, setup & 15);
             q->back = (q->back+1)%3;
             return;
           }
           else if (setup & 0x80000000) {
-            // DMA read setup
+            // DMA read setup (NROWS words to VPM row Y, 0 meaning 16),
+            // only rows of one word being supported
+            int rows = (setup >> 16) & 15;
+            int y    = (setup >> 4) & 0x7f;
+            assert(((setup >> 20) & 15) == 1);
+            s->loadRows = rows == 0 ? NUM_LANES : rows;
+            s->loadAddr = vpmAddr(y, setup & 15);
+            assert((y & 15) + s->loadRows <= NUM_LANES);
             return;
           }
           break;
@@ -196,11 +225,17 @@ void writeReg(QPUState* s, bool setFlags, AssignCond cond, Reg dest, Vec v)
             return;
           }
           else if ((setup & 0xc0000000) == 0x80000000) {
-            // DMA write setup
+            // DMA write setup (UNITS words from VPM row Y)
+            int units = (setup >> 23) & 0x7f;
+            int y     = (setup >> 7) & 0x7f;
+            s->storeUnits = units == 0 ? 128 : units;
+            s->storeAddr  = vpmAddr(y, (setup >> 3) & 15);
+            assert((y & 15) + s->storeUnits <= NUM_LANES);
             return;
           }
           else if ((setup & 0xc0000000) == 0) {
             // Setup VPM store
+            s->vpmWriteAddr = vpmAddr(setup & 0x30, setup & 15);
             return;
           }
           break;
@@ -229,11 +264,33 @@ void writeReg(QPUState* s, bool setFlags, AssignCond cond, Reg dest, Vec v)
           Vec val;
           for (int i = 0; i < NUM_LANES; i++) {
             uint32_t a = (uint32_t) v.elems[i].intVal;
-            val.elems[i].intVal = emuHeap[a>>2];
+            val.elems[i].intVal = heapLoad(a);
           }
           s->loadBuffer->append(val);
           return;
         }
+        case SPECIAL_SFU_RECIP:
+        case SPECIAL_SFU_RECIPSQRT:
+        case SPECIAL_SFU_EXP:
+        case SPECIAL_SFU_LOG: {
+          // Result appears in accumulator 4
+          Vec r;
+          for (int i = 0; i < NUM_LANES; i++) {
+            float x = v.elems[i].floatVal;
+            switch (dest.regId) {
+              case SPECIAL_SFU_RECIP:     r.elems[i].floatVal = 1.0f/x; break;
+              case SPECIAL_SFU_RECIPSQRT: r.elems[i].floatVal = 1.0f/sqrtf(x);
+                                          break;
+              case SPECIAL_SFU_EXP:       r.elems[i].floatVal = exp2f(x); break;
+              case SPECIAL_SFU_LOG:       r.elems[i].floatVal = log2f(x); break;
+            }
+          }
+          Reg acc4;
+          acc4.tag   = ACC;
+          acc4.regId = 4;
+          writeReg(s, false, cond, acc4, r);
+          return;
+        }
         default:
           break;
       }
@@ -285,6 +342,99 @@ Vec rotate(Vec v, int n)
   return w;
 }
 
+// ============================================================================
+// Packed 8-bit arithmetic
+// ============================================================================
+
+// Apply a V8 operator to each of the four unsigned bytes of a word.
+// Addition and subtraction saturate to [0, 255].  Multiplication
+// treats each byte as a fraction of 255, rounding to nearest.
+
+int32_t v8Apply(ALUOp op, int32_t a, int32_t b)
+{
+  uint32_t result = 0;
+  for (int i = 0; i < 32; i += 8) {
+    int x = ((uint32_t) a >> i) & 0xff;
+    int y = ((uint32_t) b >> i) & 0xff;
+    int z;
+    switch (op) {
+      case A_V8ADDS: case M_V8ADDS: z = x+y > 255 ? 255 : x+y; break;
+      case A_V8SUBS: case M_V8SUBS: z = x-y < 0 ? 0 : x-y; break;
+      case M_V8MUL:                 z = (x*y + 127) / 255; break;
+      case M_V8MIN:                 z = x < y ? x : y; break;
+      case M_V8MAX:                 z = x > y ? x : y; break;
+      default:                      assert(false);
+    }
+    result |= (uint32_t) z << i;
+  }
+  return (int32_t) result;
+}
+
+// ============================================================================
+// Sub-word pack and unpack
+// ============================================================================
+
+// Unpack a byte, zero-extended, or a half-word, sign-extended
+
+int32_t unpackSubWord(SubWord sw, int32_t x)
+{
+  uint32_t ux = (uint32_t) x;
+  switch (sw) {
+    case A8:  return ux & 0xff;
+    case B8:  return (ux >> 8) & 0xff;
+    case C8:  return (ux >> 16) & 0xff;
+    case D8:  return ux >> 24;
+    case A16: return (int16_t) (ux & 0xffff);
+    case B16: return x >> 16;
+    case A32: return x;
+  }
+  assert(false);
+}
+
+// Unpack a half-word holding a half-precision float, which converts
+// exactly, NaNs keeping their payload
+
+float unpackHalfFloat(SubWord sw, int32_t x)
+{
+  assert(sw == A16 || sw == B16);
+  uint32_t h    = (uint32_t) unpackSubWord(sw, x) & 0xffff;
+  uint32_t sign = (h & 0x8000) << 16;
+  uint32_t exp  = (h >> 10) & 0x1f;
+  uint32_t man  = h & 0x3ff;
+  uint32_t bits;
+  if (exp == 0) {
+    float f = ldexpf((float) man, -24);
+    memcpy(&bits, &f, 4);
+  }
+  else if (exp == 0x1f)
+    bits = 0x7f800000 | (man << 13);
+  else
+    bits = ((exp + 112) << 23) | (man << 13);
+  bits |= sign;
+  float f;
+  memcpy(&f, &bits, 4);
+  return f;
+}
+
+// Replace a sub-word of a word by the low bits of x
+
+int32_t packSubWord(SubWord sw, int32_t word, int32_t x)
+{
+  int shift, width;
+  switch (sw) {
+    case A8:  shift = 0;  width = 8;  break;
+    case B8:  shift = 8;  width = 8;  break;
+    case C8:  shift = 16; width = 8;  break;
+    case D8:  shift = 24; width = 8;  break;
+    case A16: shift = 0;  width = 16; break;
+    case B16: shift = 16; width = 16; break;
+    case A32: return x;
+  }
+  uint32_t mask = ((1u << width) - 1) << shift;
+  return (int32_t) (((uint32_t) word & ~mask) |
+                    (((uint32_t) x << shift) & mask));
+}
+
 // ============================================================================
 // Interpret a small immediate operand
 // ============================================================================
@@ -500,6 +650,10 @@ Vec alu(QPUState* s, Seq<int32_t>* uniforms,
     case M_V8MAX:
     case M_V8ADDS:
     case M_V8SUBS:
+      // Packed 8-bit arithmetic
+      for (int i = 0; i < NUM_LANES; i++)
+        c[i].intVal = v8Apply(op, a[i].intVal, b[i].intVal);
+      break;
     default:
       printf("QPULib: unsupported operator %i\n", op);
       abort();
@@ -507,6 +661,34 @@ Vec alu(QPUState* s, Seq<int32_t>* uniforms,
   return z;
 }
 
+// Sub-word operations: the result is written to the whole destination,
+// 'A_PACK' merging it with the destination's current value
+
+Vec subWordOp(QPUState* s, Seq<int32_t>* uniforms, Instr instr)
+{
+  Vec x = readRegOrImm(s, uniforms, instr.ALU.srcA);
+  Vec result;
+  if (instr.ALU.op == A_PACK) {
+    assert(instr.ALU.dest.tag == REG_A);
+    result = readReg(s, uniforms, instr.ALU.dest);
+  }
+  else
+    assert(instr.ALU.srcA.tag == REG && instr.ALU.srcA.reg.tag == REG_A);
+
+  SubWord sw = instr.ALU.subWord;
+  for (int i = 0; i < NUM_LANES; i++) {
+    Word* w = &result.elems[i];
+    int32_t a = x.elems[i].intVal;
+    switch (instr.ALU.op) {
+      case A_UNPACK:  w->intVal = unpackSubWord(sw, a); break;
+      case A_FUNPACK: w->floatVal = unpackHalfFloat(sw, a); break;
+      case A_PACK:    w->intVal = packSubWord(sw, w->intVal, a); break;
+      default:        assert(false);
+    }
+  }
+  return result;
+}
+
 // ============================================================================
 // In-flight memory requests
 // ============================================================================
@@ -593,6 +775,11 @@ void emulate
     q.vpmLoadQueue.front = 0;
     q.readStride         = 0;
     q.writeStride        = 0;
+    q.vpmWriteAddr       = vpmAddr(32, i);
+    q.loadAddr           = vpmAddr(0, i);
+    q.loadRows           = NUM_LANES;
+    q.storeAddr          = vpmAddr(32, i);
+    q.storeUnits         = NUM_LANES;
     q.loadBuffer         = new SmallSeq<Vec>;
     state.qpu[i]         = q;
   }
@@ -619,6 +806,11 @@ void emulate
           }
           // ALU operation
           case ALU: {
+            if (isSubWordOp(instr.ALU.op)) {
+              writeReg(s, instr.ALU.setFlags, instr.ALU.cond,
+                       instr.ALU.dest, subWordOp(s, uniforms, instr));
+              break;
+            }
             Vec result = alu(s, uniforms, instr.ALU.srcA,
                              instr.ALU.op, instr.ALU.srcB);
             if (instr.ALU.op != NOP)
@@ -661,16 +853,16 @@ void emulate
             s->dmaLoad.active = true;
             s->dmaLoad.addr   = addr.elems[0];
             s->dmaLoad.buffer = instr.LD1.buffer;
+            s->loadAddr       = vpmAddr(instr.LD1.buffer == A ? 0 : 16, s->id);
+            s->loadRows       = NUM_LANES;
             break;
           }
           // LD2: wait for DMA completion
           case LD2: {
             assert(s->dmaLoad.active);
             uint32_t hp = (uint32_t) s->dmaLoad.addr.intVal;
-            int vpmAddr = NUM_LANES *
-                            (4*s->id + (s->dmaLoad.buffer == A ? 0 : 1));
-            for (int i = 0; i < NUM_LANES; i++) {
-              state.vpm[vpmAddr+i].intVal = emuHeap[hp>>2];
+            for (int i = 0; i < s->loadRows; i++) {
+              state.vpm[s->loadAddr+i].intVal = heapLoad(hp);
               hp += 4*(s->readStride+1);
             }
             s->dmaLoad.active = false;
@@ -680,8 +872,8 @@ void emulate
           case LD3: {
             VPMLoadQueue* q = &s->vpmLoadQueue;
             assert((q->back+1)%3 != q->front); // Assert not full
-            q->addrs[q->back] = NUM_LANES *
-              (4*s->id + (instr.LD3.buffer == A ? 0 : 1));
+            q->addrs[q->back] =
+              vpmAddr(instr.LD3.buffer == A ? 0 : 16, s->id);
             q->back = (q->back+1)%3;
             break;
           }
@@ -689,11 +881,11 @@ void emulate
           case LD4: {
             VPMLoadQueue* q = &s->vpmLoadQueue;
             assert(q->back != q->front); // Assert not empty
-            int vpmAddr = q->addrs[q->front];
+            int addr = q->addrs[q->front];
             q->front = (q->front+1)%3;
             Vec v;
             for (int i = 0; i < NUM_LANES; i++)
-              v.elems[i] = state.vpm[vpmAddr+i];
+              v.elems[i] = state.vpm[addr+i];
             AssignCond always;
             always.tag = ALWAYS;
             writeReg(s, false, always, instr.LD4.dest, v);
@@ -702,10 +894,8 @@ void emulate
           // ST1: write the vector to VPM (local) memory
           case ST1: {
             Vec v = readReg(s, uniforms, instr.ST1.data);
-            int vpmAddr = NUM_LANES * 
-              (4*s->id + (instr.ST1.buffer == A ? 2 : 3));
             for (int i = 0; i < NUM_LANES; i++)
-              state.vpm[vpmAddr+i] = v.elems[i];
+              state.vpm[s->vpmWriteAddr+i] = v.elems[i];
             break;
           }
           // ST2: DMA from the VPM out to DRAM
@@ -715,16 +905,16 @@ void emulate
             s->dmaStore.addr = addr.elems[0];
             s->dmaStore.buffer = instr.ST2.buffer;
             s->dmaStore.active = true;
+            s->storeAddr       = vpmAddr(instr.ST2.buffer == A ? 32 : 48, s->id);
+            s->storeUnits      = NUM_LANES;
             break;
           }
           // ST3: wait for DMA to complete
           case ST3: {
             if (s->dmaStore.active) {
               uint32_t hp = (uint32_t) s->dmaStore.addr.intVal;
-              int vpmAddr = NUM_LANES *
-                (4*s->id + (s->dmaStore.buffer == A ? 2 : 3));
-              for (int i = 0; i < NUM_LANES; i++) {
-                emuHeap[hp>>2] = state.vpm[vpmAddr+i].intVal;
+              for (int i = 0; i < s->storeUnits; i++) {
+                heapStore(hp, state.vpm[s->storeAddr+i].intVal);
                 hp += 4*(s->writeStride+1);
               }
               s->dmaStore.active = false;
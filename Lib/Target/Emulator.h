@@ -53,6 +53,11 @@ struct QPUState {
   VPMLoadQueue vpmLoadQueue; // VPM load queue
   int readStride;            // Read stride
   int writeStride;           // Write stride
+  int vpmWriteAddr;          // VPM address written by ST1
+  int loadAddr;              // VPM address of a DMA load
+  int loadRows;              // Number of words in a DMA load
+  int storeAddr;             // VPM address of a DMA store
+  int storeUnits;            // Number of words in a DMA store
   SmallSeq<Vec>* loadBuffer; // Load buffer for loads via TMU
 };
 
@@ -81,6 +86,14 @@ extern int32_t* emuHeap;
 // Rotate a vector
 Vec rotate(Vec v, int n);
 
+// Apply a packed 8-bit operator (A_V8ADDS etc.) to two words
+int32_t v8Apply(ALUOp op, int32_t a, int32_t b);
+
+// Sub-word unpack (A_UNPACK and A_FUNPACK) and pack (A_PACK) modes
+int32_t unpackSubWord(SubWord sw, int32_t x);
+float unpackHalfFloat(SubWord sw, int32_t x);
+int32_t packSubWord(SubWord sw, int32_t word, int32_t x);
+
 // Printing routines
 void emitChar(Seq<char>* out, char c);
 void emitStr(Seq<char>* out, const char* s);
@@ -57,6 +57,28 @@ uint32_t encodeMulOp(ALUOp op)
   exit(EXIT_FAILURE);
 }
 
+// ==================
+// Sub-word selectors
+// ==================
+
+// Unpack and pack mode of register file A, the two fields sharing an
+// encoding for the selectors used
+
+uint32_t encodeSubWord(SubWord sw)
+{
+  switch (sw) {
+    case A16: return 1;
+    case B16: return 2;
+    case A8:  return 4;
+    case B8:  return 5;
+    case C8:  return 6;
+    case D8:  return 7;
+    default:  break;
+  }
+  fprintf(stderr, "QPULib: unsupported sub-word selector\n");
+  exit(EXIT_FAILURE);
+}
+
 // ===============
 // Condition flags
 // ===============
@@ -136,6 +158,10 @@ uint32_t encodeDestReg(Reg reg, RegTag* file)
         case SPECIAL_VPM_WRITE:   *file = REG_A; return 48;
         case SPECIAL_HOST_INT:    *file = REG_A; return 38;
         case SPECIAL_TMU0_S:      *file = REG_A; return 56;
+        case SPECIAL_SFU_RECIP:     *file = REG_A; return 52;
+        case SPECIAL_SFU_RECIPSQRT: *file = REG_A; return 53;
+        case SPECIAL_SFU_EXP:       *file = REG_A; return 54;
+        case SPECIAL_SFU_LOG:       *file = REG_A; return 55;
         default:                  break;
       }
     case NONE: *file = REG_A; return 39;
@@ -269,6 +295,23 @@ void encodeInstr(Instr instr, uint32_t* high, uint32_t* low)
 
     // ALU
     case ALU: {
+      // Sub-word operations are moves using the unpack or pack mode,
+      // the float conversion of the unpack being triggered by a float
+      // operation consuming the value
+      uint32_t unpack = 0, pack = 0;
+      if (instr.ALU.op == A_UNPACK || instr.ALU.op == A_FUNPACK) {
+        assert(instr.ALU.srcA.tag == REG && instr.ALU.srcA.reg.tag == REG_A);
+        unpack = encodeSubWord(instr.ALU.subWord) << 25;
+        instr.ALU.op = instr.ALU.op == A_UNPACK ? A_BOR : A_FMIN;
+        instr.ALU.srcB = instr.ALU.srcA;
+      }
+      else if (instr.ALU.op == A_PACK) {
+        assert(instr.ALU.dest.tag == REG_A);
+        pack = encodeSubWord(instr.ALU.subWord) << 20;
+        instr.ALU.op = A_BOR;
+        instr.ALU.srcB = instr.ALU.srcA;
+      }
+
       RegTag file;
       bool isMul     = isMulOp(instr.ALU.op);
       bool hasImm    = instr.ALU.srcA.tag == IMM || instr.ALU.srcB.tag == IMM;
@@ -288,11 +331,12 @@ void encodeInstr(Instr instr, uint32_t* high, uint32_t* low)
         ws        = (file == REG_A ? 0 : 1) << 12;
       }
       uint32_t sf    = (instr.ALU.setFlags ? 1 : 0) << 13;
-      *high          = sig | cond | ws | sf | waddr_add | waddr_mul;
+      *high          = sig | unpack | pack | cond | ws | sf |
+                       waddr_add | waddr_mul;
 
       if (instr.ALU.op == M_ROTATE) {
         assert(instr.ALU.srcA.tag == REG && instr.ALU.srcA.reg.tag == ACC &&
-               instr.ALU.srcA.reg.regId == 0);
+               instr.ALU.srcA.reg.regId >= 0 && instr.ALU.srcA.reg.regId <= 3);
         assert(instr.ALU.srcB.tag == REG ?
                instr.ALU.srcB.reg.tag == ACC && instr.ALU.srcB.reg.regId == 5
                : true);
@@ -307,7 +351,9 @@ void encodeInstr(Instr instr, uint32_t* high, uint32_t* low)
           raddrb = 48 + n;
         }
         uint32_t raddra = 39;
-        *low = mulOp | (raddrb << 12) | (raddra << 18);
+        // Both mul operands are taken from the rotated accumulator
+        uint32_t mux    = (uint32_t) instr.ALU.srcA.reg.regId;
+        *low = mulOp | (raddrb << 12) | (raddra << 18) | (mux << 3) | mux;
         return;
       }
       else {
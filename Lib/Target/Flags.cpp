@@ -0,0 +1,279 @@
+// Condition-flag analysis and optimisation
+
+#include "Target/Flags.h"
+#include "Target/Liveness.h"
+
+// ============================================================================
+// Flag readers and writers
+// ============================================================================
+
+bool readsFlags(Instr instr)
+{
+  switch (instr.tag) {
+    case LI:  return instr.LI.cond.tag == FLAG;
+    case ALU: return instr.ALU.cond.tag == FLAG;
+    case BRL: return instr.BRL.cond.tag == COND_ALL ||
+                     instr.BRL.cond.tag == COND_ANY;
+    case BR:  return instr.BR.cond.tag == COND_ALL ||
+                     instr.BR.cond.tag == COND_ANY;
+  }
+  return false;
+}
+
+static bool setsFlags(Instr instr)
+{
+  if (instr.tag == LI) return instr.LI.setFlags;
+  if (instr.tag == ALU) return instr.ALU.setFlags;
+  return false;
+}
+
+// A conditional flag-setting instruction only updates the flags of
+// the lanes where its condition holds.
+
+bool setsAllFlags(Instr instr)
+{
+  if (instr.tag == LI)
+    return instr.LI.setFlags && instr.LI.cond.tag == ALWAYS;
+  if (instr.tag == ALU)
+    return instr.ALU.setFlags && instr.ALU.cond.tag == ALWAYS;
+  return false;
+}
+
+// ============================================================================
+// Flag liveness
+// ============================================================================
+
+// The condition flags are live-in to an instruction if it reads them,
+// or if they are live-out and the instruction does not overwrite them.
+
+void flagLiveness(Seq<Instr>* instrs, CFG* cfg, bool* liveOut)
+{
+  int n = instrs->numElems;
+  bool* liveIn = new bool [n];
+  for (int i = 0; i < n; i++) liveIn[i] = liveOut[i] = false;
+
+  // Iterate until no change, i.e. fixed point
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = n-1; i >= 0; i--) {
+      Instr instr = instrs->elems[i];
+
+      bool out = false;
+      Succs* s = &cfg->elems[i];
+      for (int j = 0; j < s->numElems; j++)
+        out = out || liveIn[s->elems[j]];
+
+      bool in = readsFlags(instr) || (out && !setsAllFlags(instr));
+
+      changed = changed || in != liveIn[i] || out != liveOut[i];
+      liveIn[i]  = in;
+      liveOut[i] = out;
+    }
+  }
+
+  delete [] liveIn;
+}
+
+// ============================================================================
+// Redundant flag elimination
+// ============================================================================
+
+// Is the instruction a register-to-register move?
+
+static bool isMove(Instr instr)
+{
+  return instr.tag == ALU && instr.ALU.op == A_BOR &&
+         instr.ALU.srcA.tag == REG && instr.ALU.srcB.tag == REG &&
+         instr.ALU.srcA.reg == instr.ALU.srcB.reg;
+}
+
+// Is the operand stable, i.e. does reading it twice give the same
+// value provided it is not written in between?  Special registers
+// such as the uniform FIFO are not.
+
+static bool isStable(RegOrImm x)
+{
+  return x.tag == IMM || x.reg.tag != SPECIAL;
+}
+
+static bool sameOperand(RegOrImm x, RegOrImm y)
+{
+  if (x.tag != y.tag) return false;
+  if (x.tag == REG) return x.reg == y.reg;
+  return x.smallImm.tag == y.smallImm.tag && x.smallImm.val == y.smallImm.val;
+}
+
+// Do two ALU instructions compute the same value?
+
+static bool sameComputation(Instr a, Instr b)
+{
+  return a.tag == ALU && b.tag == ALU && a.ALU.op == b.ALU.op &&
+         isStable(a.ALU.srcA) && isStable(a.ALU.srcB) &&
+         sameOperand(a.ALU.srcA, b.ALU.srcA) &&
+         sameOperand(a.ALU.srcB, b.ALU.srcB);
+}
+
+// Does the instruction read the given operand register?
+
+static bool isSource(Instr instr, Reg r)
+{
+  return (instr.ALU.srcA.tag == REG && instr.ALU.srcA.reg == r) ||
+         (instr.ALU.srcB.tag == REG && instr.ALU.srcB.reg == r);
+}
+
+// Are the flags set by the operation a function of the bits of its
+// result?  Not necessarily for floating-point results, e.g. -0.0.
+
+static bool intFlags(ALUOp op)
+{
+  return op != A_FADD && op != A_FSUB && op != A_FMIN && op != A_FMAX &&
+         op != A_FMINABS && op != A_FMAXABS && op != A_ItoF &&
+         op != M_FMUL;
+}
+
+static void removeReg(SmallSeq<Reg>* set, Reg r)
+{
+  for (int i = 0; i < set->numElems; i++)
+    if (set->elems[i] == r) { set->remove(i); return; }
+}
+
+// First pass: within each basic block, track the instruction that
+// last set the flags and the registers holding the value the flags
+// were computed from.  A later flag-setting instruction computing the
+// same thing, or moving one of those registers, need not set the
+// flags; if its destination is unused it can be removed altogether.
+// For example, chained 'Where' statements on the same condition
+// compile to repeated comparisons, of which only the first remains.
+
+static void reuseFlags(Seq<Instr>* instrs, bool* del)
+{
+  CFG cfg;
+  buildCFG(instrs, &cfg);
+  Liveness live;
+  liveness(instrs, &cfg, &live);
+  LiveSet liveOut;
+
+  // Instruction that last set the flags, if its operands are unchanged
+  bool avail = false;
+  Instr setter;
+
+  // Registers holding the value the flags were computed from
+  bool haveHolders = false;
+  SmallSeq<Reg> holders;
+
+  UseDefReg set;
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr instr = instrs->elems[i];
+    del[i] = false;
+
+    if (instr.tag == LAB) {
+      avail = haveHolders = false;
+      holders.clear();
+      continue;
+    }
+
+    bool redundant = false;
+    if (setsAllFlags(instr) && instr.tag == ALU) {
+      redundant = (avail && sameComputation(setter, instr)) ||
+                  (haveHolders && isMove(instr) &&
+                   holders.member(instr.ALU.srcA.reg));
+
+      if (redundant) {
+        Reg dest = instr.ALU.dest;
+        computeLiveOut(&cfg, &live, i, &liveOut);
+        if (dest.tag == NONE ||
+            (dest.tag == REG_A && !liveOut.member(dest.regId))) {
+          del[i] = true;
+          continue;
+        }
+        instrs->elems[i].ALU.setFlags = false;
+        instr.ALU.setFlags = false;
+      }
+      else {
+        setter = instr;
+        avail = !isSource(instr, instr.ALU.dest);
+        haveHolders = intFlags(instr.ALU.op);
+        holders.clear();
+        if (haveHolders) {
+          if (instr.ALU.dest.tag != NONE && instr.ALU.dest.tag != SPECIAL)
+            holders.append(instr.ALU.dest);
+          if (isMove(instr) && isStable(instr.ALU.srcA))
+            holders.insert(instr.ALU.srcA.reg);
+        }
+        continue;
+      }
+    }
+    else if (setsFlags(instr)) {
+      avail = haveHolders = false;
+      holders.clear();
+    }
+
+    // Does the instruction copy the flag value to its destination?
+    bool copy = haveHolders && instr.tag == ALU &&
+                instr.ALU.cond.tag == ALWAYS &&
+                (redundant || (isMove(instr) &&
+                               holders.member(instr.ALU.srcA.reg)));
+
+    // Writes invalidate the flag value held by the destination and,
+    // if they overwrite an operand, the last flag computation
+    useDefReg(instr, &set);
+    for (int j = 0; j < set.def.numElems; j++) {
+      Reg d = set.def.elems[j];
+      removeReg(&holders, d);
+      if (avail && isSource(setter, d)) avail = false;
+    }
+    if (copy && instr.ALU.dest.tag != SPECIAL) holders.insert(instr.ALU.dest);
+  }
+}
+
+// Second pass: flag-setting instructions whose flags are never read
+// need not set them.  If they have no destination either, they are
+// removed.
+
+static void removeDeadFlags(Seq<Instr>* instrs, bool* del)
+{
+  CFG cfg;
+  buildCFG(instrs, &cfg);
+  bool* liveOut = new bool [instrs->numElems];
+  flagLiveness(instrs, &cfg, liveOut);
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr* instr = &instrs->elems[i];
+    del[i] = false;
+    if (liveOut[i]) continue;
+
+    if (instr->tag == LI) instr->LI.setFlags = false;
+    if (instr->tag == ALU && instr->ALU.setFlags) {
+      instr->ALU.setFlags = false;
+      del[i] = instr->ALU.dest.tag == NONE &&
+               isStable(instr->ALU.srcA) && isStable(instr->ALU.srcB);
+    }
+  }
+
+  delete [] liveOut;
+}
+
+// Remove the instructions marked for deletion.
+
+static void removeMarked(Seq<Instr>* instrs, bool* del)
+{
+  int j = 0;
+  for (int i = 0; i < instrs->numElems; i++)
+    if (!del[i]) instrs->elems[j++] = instrs->elems[i];
+  instrs->numElems = j;
+}
+
+void removeRedundantFlags(Seq<Instr>* instrs)
+{
+  bool* del = new bool [instrs->numElems];
+
+  reuseFlags(instrs, del);
+  removeMarked(instrs, del);
+
+  removeDeadFlags(instrs, del);
+  removeMarked(instrs, del);
+
+  delete [] del;
+}
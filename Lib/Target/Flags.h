@@ -0,0 +1,24 @@
+// Condition-flag analysis and optimisation
+
+#ifndef _FLAGS_H_
+#define _FLAGS_H_
+
+#include "Common/Seq.h"
+#include "Target/Syntax.h"
+#include "Target/CFG.h"
+
+// Does the instruction read the implicit condition flags?
+bool readsFlags(Instr instr);
+
+// Does the instruction overwrite the condition flags of every lane?
+bool setsAllFlags(Instr instr);
+
+// Compute, for each instruction, whether the condition flags are
+// live on exit from it, i.e. may be read before being overwritten.
+void flagLiveness(Seq<Instr>* instrs, CFG* cfg, bool* liveOut);
+
+// Remove flag-setting operations whose results are already present
+// in the condition flags, or are never read.
+void removeRedundantFlags(Seq<Instr>* instrs);
+
+#endif
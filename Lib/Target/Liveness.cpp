@@ -107,6 +107,12 @@ void useDef(Instr instr, UseDef* out)
     Reg r = set.def.elems[i];
     if (r.tag == REG_A) out->def.append(r.regId);
   }
+
+  // A write to a sub-word keeps the rest of the variable's value.
+  // (The register itself is not read, so needs no hazard NOP.)
+  if (instr.tag == ALU && instr.ALU.op == A_PACK &&
+      instr.ALU.dest.tag == REG_A)
+    out->use.append(instr.ALU.dest.regId);
 }
 
 // Compute the union of the 'use' sets of the successors of a given
@@ -19,18 +19,6 @@ void genSetReadStride(Seq<Instr>* instrs, int stride)
   instrs->append(instr);
 }
 
-void genSetReadStride(Seq<Instr>* instrs, Reg stride)
-{
-  Reg pitch = freshReg();
-  Reg tmp = freshReg();
-  instrs->append(genIncr(pitch, stride, 1));
-  instrs->append(genLI(tmp, 0x90000000));
-  instrs->append(genLShift(pitch, pitch, 2));
-
-  Reg dst; dst.tag = REG_A; dst.regId = RSV_READ_STRIDE;
-  instrs->append(genOR(dst, tmp, pitch));
-}
-
 // Generate instructions to set the write stride.
 
 void genSetWriteStride(Seq<Instr>* instrs, int stride)
@@ -43,17 +31,6 @@ void genSetWriteStride(Seq<Instr>* instrs, int stride)
   instrs->append(instr);
 }
 
-void genSetWriteStride(Seq<Instr>* instrs, Reg stride)
-{
-  Reg tmp0 = freshReg();
-  Reg tmp1 = freshReg();
-  instrs->append(genLShift(tmp0, stride, 2));
-  instrs->append(genLI(tmp1, 0xc0010000));
-
-  Reg dst; dst.tag = REG_A; dst.regId = RSV_WRITE_STRIDE;
-  instrs->append(genOR(dst, tmp0, tmp1));
-}
-
 // =============================================================================
 // DMA setup
 // =============================================================================
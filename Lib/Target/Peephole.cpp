@@ -0,0 +1,271 @@
+#include <assert.h>
+#include <stdio.h>
+#include "Target/Peephole.h"
+#include "Target/Liveness.h"
+
+// ============================================================================
+// Peephole optimisation
+// ============================================================================
+
+// This pass runs after register allocation and satisfy(), so each rule
+// works on physical registers and must preserve the constraints that
+// satisfy() has established.  A rule is tried at each instruction
+// index and returns true if it rewrote the code at that index.  Rules
+// are applied repeatedly until none fires.
+
+// Is the instruction a register-to-register move?
+
+static bool isMove(Instr instr)
+{
+  return instr.tag == ALU && instr.ALU.op == A_BOR &&
+         instr.ALU.srcA.tag == REG && instr.ALU.srcB.tag == REG &&
+         instr.ALU.srcA.reg == instr.ALU.srcB.reg;
+}
+
+// Is the register an accumulator in the range r0..r3?
+
+static bool isGeneralAcc(Reg r)
+{
+  return r.tag == ACC && r.regId >= 0 && r.regId <= 3;
+}
+
+// Does the instruction read or write the given register?
+
+static bool reads(Instr instr, Reg r)
+{
+  UseDefReg set;
+  useDefReg(instr, &set);
+  return set.use.member(r);
+}
+
+static bool writes(Instr instr, Reg r)
+{
+  UseDefReg set;
+  useDefReg(instr, &set);
+  return set.def.member(r);
+}
+
+// Would removing the instruction at index i bring a write to register
+// file A or B next to a read of the same register?  satisfy() has
+// already separated such pairs by at least one instruction, and
+// nothing re-checks them after this pass.
+
+static bool removalHazard(Seq<Instr>* instrs, int i)
+{
+  int p = i-1, n = i+1;
+  while (p >= 0 && instrs->elems[p].tag == LAB) p--;
+  while (n < instrs->numElems && instrs->elems[n].tag == LAB) n++;
+  if (p < 0 || n >= instrs->numElems) return false;
+
+  UseDefReg prev, next;
+  useDefReg(instrs->elems[p], &prev);
+  useDefReg(instrs->elems[n], &next);
+  for (int k = 0; k < prev.def.numElems; k++) {
+    Reg r = prev.def.elems[k];
+    if (isRegAorB(r.tag) && next.use.member(r)) return true;
+  }
+  return false;
+}
+
+// ============================================================================
+// Rules
+// ============================================================================
+
+// Rule: self-move
+//
+//   r <- r       ===>   (removed)
+//
+// Arises when register allocation assigns the source and destination
+// of a move to the same register.  Kept if it separates a register
+// file write from a read of it.
+
+static bool selfMove(Seq<Instr>* instrs, int i)
+{
+  Instr instr = instrs->elems[i];
+  if (!isMove(instr) || instr.ALU.setFlags) return false;
+
+  Reg dest = instr.ALU.dest;
+  if (!isRegAorB(dest.tag) && dest.tag != ACC) return false;
+  if (!(dest == instr.ALU.srcA.reg)) return false;
+  if (removalHazard(instrs, i)) return false;
+
+  instrs->remove(i);
+  return true;
+}
+
+// Rule: rotate operand already in an accumulator
+//
+//   acc0 <- accN                 (acc5 <- x)
+//   (acc5 <- x)         ===>     (nop)
+//   (nop)                        rotate(accN, ...)
+//   rotate(acc0, ...)
+//
+// where N is in 1..3.  The full vector rotate can read any of r0..r3;
+// satisfy() always moves the operand into r0.  This assumes that r0
+// holds no value beyond the end of a basic block, which is true of
+// both satisfy() and accumulator allocation.  Not applied if the move
+// separates a register file write from a read of it.
+
+static bool rotateAcc(Seq<Instr>* instrs, int i)
+{
+  Instr move = instrs->elems[i];
+  if (!isMove(move) || move.ALU.setFlags || move.ALU.cond.tag != ALWAYS)
+    return false;
+
+  Reg acc0; acc0.tag = ACC; acc0.regId = 0;
+  if (!(move.ALU.dest == acc0) || !isGeneralAcc(move.ALU.srcA.reg) ||
+      move.ALU.srcA.reg == acc0)
+    return false;
+  if (removalHazard(instrs, i)) return false;
+
+  // Skip over rotation-amount move and NOP
+  int j = i+1;
+  if (j < instrs->numElems && isMove(instrs->elems[j]) &&
+      instrs->elems[j].ALU.dest.tag == ACC &&
+      instrs->elems[j].ALU.dest.regId == 5 &&
+      !reads(instrs->elems[j], acc0)) j++;
+  if (j < instrs->numElems && instrs->elems[j].tag == NO_OP) j++;
+  if (j >= instrs->numElems) return false;
+
+  Instr rot = instrs->elems[j];
+  if (rot.tag != ALU || rot.ALU.op != M_ROTATE) return false;
+  if (!(rot.ALU.srcA.tag == REG && rot.ALU.srcA.reg == acc0)) return false;
+
+  // Value moved into r0 must not be read after the rotate
+  if (!writes(rot, acc0)) {
+    for (int k = j+1; k < instrs->numElems; k++) {
+      Instr instr = instrs->elems[k];
+      if (instr.tag == LAB || instr.tag == BRL || instr.tag == END) break;
+      if (reads(instr, acc0)) return false;
+      if (writes(instr, acc0)) break;
+    }
+  }
+
+  instrs->elems[j].ALU.srcA.reg = move.ALU.srcA.reg;
+  instrs->remove(i);
+  return true;
+}
+
+// Rule: unnecessary rotate NOP
+//
+//   x <- f(...)                 x <- f(...)
+//   nop                ===>     rotate(a, b)
+//   rotate(a, b)
+//
+// if x is neither a nor b.  A rotate must not immediately follow a
+// write to the accumulator being rotated, or to r5 when rotating by
+// r5, but otherwise needs no NOP.
+
+static bool rotateNop(Seq<Instr>* instrs, int i)
+{
+  if (i == 0 || i+1 >= instrs->numElems) return false;
+  if (instrs->elems[i].tag != NO_OP) return false;
+
+  Instr prev = instrs->elems[i-1];
+  Instr rot  = instrs->elems[i+1];
+  if (prev.tag != ALU && prev.tag != LI) return false;
+  if (rot.tag != ALU || rot.ALU.op != M_ROTATE) return false;
+
+  if (rot.ALU.srcA.tag == REG && writes(prev, rot.ALU.srcA.reg))
+    return false;
+  if (rot.ALU.srcB.tag == REG && writes(prev, rot.ALU.srcB.reg))
+    return false;
+
+  instrs->remove(i);
+  return true;
+}
+
+// Rule: unnecessary hazard NOP
+//
+//   r <- f(...)                 r <- f(...)
+//   nop                ===>     g(...)
+//   g(...)
+//
+// if r is in register file A or B and is not read by g.  Such NOPs
+// become redundant when other rules remove the instruction that read
+// r.  NOPs inserted for other reasons (branch delay slots, VPM setup
+// latency, rotates) never follow a write to register file A or B.
+
+static bool hazardNop(Seq<Instr>* instrs, int i)
+{
+  if (i == 0 || i+1 >= instrs->numElems) return false;
+  if (instrs->elems[i].tag != NO_OP) return false;
+
+  Instr prev = instrs->elems[i-1];
+  Instr next = instrs->elems[i+1];
+  if (prev.tag != ALU && prev.tag != LI) return false;
+  if (next.tag == LAB) return false;
+
+  Reg dest = prev.tag == ALU ? prev.ALU.dest : prev.LI.dest;
+  if (!isRegAorB(dest.tag) || reads(next, dest)) return false;
+
+  instrs->remove(i);
+  return true;
+}
+
+// ============================================================================
+// Rule catalogue
+// ============================================================================
+
+struct PeepholeRule {
+  const char* name;
+  bool (*apply)(Seq<Instr>* instrs, int i);
+};
+
+static PeepholeRule rules[] = {
+    { "self-move",   selfMove  }
+  , { "rotate-acc",  rotateAcc }
+  , { "rotate-nop",  rotateNop }
+  , { "hazard-nop",  hazardNop }
+};
+
+#define NUM_RULES ((int) (sizeof(rules) / sizeof(PeepholeRule)))
+
+static int hits[NUM_RULES];
+
+int numPeepholeRules()
+{
+  return NUM_RULES;
+}
+
+const char* peepholeRuleName(int rule)
+{
+  assert(rule >= 0 && rule < NUM_RULES);
+  return rules[rule].name;
+}
+
+int peepholeRuleHits(int rule)
+{
+  assert(rule >= 0 && rule < NUM_RULES);
+  return hits[rule];
+}
+
+void resetPeepholeHits()
+{
+  for (int r = 0; r < NUM_RULES; r++) hits[r] = 0;
+}
+
+void printPeepholeHits()
+{
+  printf("Peephole rule hits\n");
+  for (int r = 0; r < NUM_RULES; r++)
+    printf("  %-12s %i\n", rules[r].name, hits[r]);
+}
+
+// ============================================================================
+// Interface
+// ============================================================================
+
+void peephole(Seq<Instr>* instrs)
+{
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < instrs->numElems; i++)
+      for (int r = 0; r < NUM_RULES; r++)
+        if (i < instrs->numElems && rules[r].apply(instrs, i)) {
+          hits[r]++;
+          changed = true;
+        }
+  }
+}
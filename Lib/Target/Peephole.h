@@ -0,0 +1,19 @@
+#ifndef _PEEPHOLE_H_
+#define _PEEPHOLE_H_
+
+#include "Common/Seq.h"
+#include "Target/Syntax.h"
+
+// Apply the catalogue of peephole rewrites to target code that has
+// been through register allocation and satisfy().
+void peephole(Seq<Instr>* instrs);
+
+// Each rule counts the number of times it has fired since the last
+// reset, accumulated over all kernels compiled.
+int numPeepholeRules();
+const char* peepholeRuleName(int rule);
+int peepholeRuleHits(int rule);
+void resetPeepholeHits();
+void printPeepholeHits();
+
+#endif
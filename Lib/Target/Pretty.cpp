@@ -28,6 +28,10 @@ const char* specialStr(RegId rid)
     case SPECIAL_VPM_WRITE:    return "VPM_WRITE";
     case SPECIAL_HOST_INT:     return "HOST_INT";
     case SPECIAL_TMU0_S:       return "TMU0_S";
+    case SPECIAL_SFU_RECIP:    return "SFU_RECIP";
+    case SPECIAL_SFU_RECIPSQRT: return "SFU_RECIPSQRT";
+    case SPECIAL_SFU_EXP:      return "SFU_EXP";
+    case SPECIAL_SFU_LOG:      return "SFU_LOG";
   }
 
   // Unreachable
@@ -158,6 +162,9 @@ void pretty(ALUOp op)
     case M_V8ADDS:  printf("m_addsatb"); return;
     case M_V8SUBS:  printf("m_subsatb"); return;
     case M_ROTATE:  printf("rotate"); return;
+    case A_UNPACK:  printf("unpack"); return;
+    case A_FUNPACK: printf("funpack"); return;
+    case A_PACK:    printf("pack"); return;
   }
 }
 
@@ -197,10 +204,13 @@ void pretty(Instr instr)
         printf(": ");
       }
       pretty(instr.ALU.dest);
+      if (instr.ALU.op == A_PACK) pretty(instr.ALU.subWord);
       printf(" <-%s ", instr.ALU.setFlags ? "{sf}" : "");
       pretty(instr.ALU.op);
       printf("(");
       pretty(instr.ALU.srcA);
+      if (instr.ALU.op == A_UNPACK || instr.ALU.op == A_FUNPACK)
+        pretty(instr.ALU.subWord);
       printf(", ");
       pretty(instr.ALU.srcB);
       printf(")\n");
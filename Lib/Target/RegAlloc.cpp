@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stdio.h>
 #include "Source/Syntax.h"
 #include "Target/Syntax.h"
@@ -5,60 +6,157 @@
 #include "Target/Subst.h"
 #include "Target/Liveness.h"
 
+// ============================================================================
+// Register file A constraints
+// ============================================================================
+
+// The unpack and pack modes apply only to register file A, so the
+// variable read by an unpack or written by a pack must be allocated
+// there.  Mark such variables in 'onlyA', of size getFreshVarCount().
+
+static void regFileAOnly(Seq<Instr>* instrs, bool* onlyA)
+{
+  for (int i = 0; i < getFreshVarCount(); i++) onlyA[i] = false;
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr instr = instrs->elems[i];
+    if (instr.tag != ALU || !isSubWordOp(instr.ALU.op)) continue;
+    Reg r = instr.ALU.op == A_PACK ? instr.ALU.dest : instr.ALU.srcA.reg;
+    assert(instr.ALU.op == A_PACK || instr.ALU.srcA.tag == REG);
+    assert(r.tag == REG_A);
+    onlyA[r.regId] = true;
+  }
+}
+
 // ============================================================================
 // Accumulator allocation
 // ============================================================================
 
-// This is a simple peephole optimisation, captured by the following
-// rewrite rule:
+// Short live ranges within a basic block are allocated to
+// accumulators r0-r3 rather than to the register files:
 //
 //   i:  x <- f(...)
 //   j:  g(..., x, ...)
-// 
-// ===> if x not live-out of j
-// 
+//       ...
+//   k:  h(..., x, ...)
+//
+// ===> if x not redefined in i+1..k, no label or branch in i..k,
+//      and x not live-out of k
+//
 //   i:  acc <- f(...)
 //   j:  g(..., acc, ...)
+//       ...
+//   k:  h(..., acc, ...)
+//
+// Reading an accumulator avoids both the register-file read-after-write
+// NOP and the A/B register-file conflict moves inserted by satisfy().
+//
+// Accumulators r4 and r5 are never allocated: r4 receives TMU results
+// and r5 holds the rotation amount of a horizontal rotate.  Accumulator
+// r0 is also used by satisfy() as scratch, so it is only allocated
+// across instructions that cannot require such a move.
+
+// Maximum number of instructions spanned by an accumulator live range
+#define ACC_MAX_RANGE 8
+
+// Can satisfy() insert a move into r0 before the given instruction?
+
+static bool mayClobberAcc0(Instr instr)
+{
+  if (instr.tag != ALU) return false;
+  if (instr.ALU.op == M_ROTATE) return true;
+
+  bool regA = instr.ALU.srcA.tag == REG && instr.ALU.srcA.reg.tag != ACC;
+  bool regB = instr.ALU.srcB.tag == REG && instr.ALU.srcB.reg.tag != ACC;
+  bool immA = instr.ALU.srcA.tag == IMM;
+  bool immB = instr.ALU.srcB.tag == IMM;
+  return (regA && regB) || (regA && immB) || (immA && regB);
+}
+
+// Does the given instruction refer to the given accumulator?
+
+static bool refersToAcc(Instr instr, RegId acc)
+{
+  UseDefReg set;
+  useDefReg(instr, &set);
+  Reg r; r.tag = ACC; r.regId = acc;
+  return set.use.member(r) || set.def.member(r);
+}
 
 void introduceAccum(CFG* cfg, Liveness* live, Seq<Instr>* instrs)
 {
-  UseDef useDefPrev, useDefCurrent;
-  LiveSet liveOut;
+  const int NUM_ACCS = 4;
 
-  Reg acc;
-  acc.tag = ACC;
-  acc.regId = 1;
+  // For each accumulator, the index of the last instruction that
+  // reads the value currently allocated to it
+  int busyUntil[NUM_ACCS];
 
-  for (int i = 1; i < instrs->numElems; i++) {
-    Instr prev  = instrs->elems[i-1];
-    Instr instr = instrs->elems[i];
+  // Accumulators already referred to by the code are left alone
+  bool reserved[NUM_ACCS];
 
-    // Compute vars defined by prev
-    useDef(prev, &useDefPrev);
+  for (int r = 0; r < NUM_ACCS; r++) {
+    busyUntil[r] = -1;
+    reserved[r] = false;
+    for (int i = 0; i < instrs->numElems; i++)
+      if (refersToAcc(instrs->elems[i], r)) { reserved[r] = true; break; }
+  }
 
-    if (useDefPrev.def.numElems > 0) {
-      RegId def = useDefPrev.def.elems[0];
+  bool* onlyA = new bool [getFreshVarCount()];
+  regFileAOnly(instrs, onlyA);
 
-      // Compute vars used by instr
-      useDef(instr, &useDefCurrent);
+  UseDef useDefSet;
+  LiveSet liveOut;
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr instr = instrs->elems[i];
 
-      // Compute vars live-out of instr
-      computeLiveOut(cfg, live, i, &liveOut);
+    // Only consider non-conditional writes to a variable
+    bool always = (instr.tag == LI && instr.LI.cond.tag == ALWAYS)
+               || (instr.tag == ALU && instr.ALU.cond.tag == ALWAYS);
+    if (!always) continue;
+    useDef(instr, &useDefSet);
+    if (useDefSet.def.numElems == 0) continue;
+    RegId def = useDefSet.def.elems[0];
+    if (onlyA[def]) continue;
 
-      // Check that write is non-conditional
-      bool always = (prev.tag == LI && prev.LI.cond.tag == ALWAYS)
-                 || (prev.tag == ALU && prev.ALU.cond.tag == ALWAYS);
+    // Find the end of the live range within the basic block
+    int end = -1;
+    bool clobbersAcc0 = false;
+    for (int j = i+1; j < instrs->numElems && j <= i+ACC_MAX_RANGE; j++) {
+      // Live range must be contained in a straight-line sequence
+      Succs* s = &cfg->elems[j-1];
+      if (s->numElems != 1 || s->elems[0] != j) break;
+      if (instrs->elems[j].tag == LAB) break;
 
-      if (always &&
-          useDefCurrent.use.member(def)  &&
-          !liveOut.member(def)) {
-        renameDest(&prev, REG_A, def, ACC, 1);
-        renameUses(&instr, REG_A, def, ACC, 1);
-        instrs->elems[i-1] = prev;
-        instrs->elems[i]   = instr;
+      clobbersAcc0 = clobbersAcc0 || mayClobberAcc0(instrs->elems[j]);
+
+      useDef(instrs->elems[j], &useDefSet);
+      if (useDefSet.use.member(def)) {
+        computeLiveOut(cfg, live, j, &liveOut);
+        if (!liveOut.member(def)) { end = j; break; }
       }
+      if (useDefSet.def.member(def)) break;
+    }
+    if (end < 0) continue;
+
+    // Choose an accumulator, preferring those not used by satisfy()
+    RegId acc = -1;
+    for (int r = 1; r <= NUM_ACCS; r++) {
+      RegId a = r % NUM_ACCS;
+      if (reserved[a] || busyUntil[a] > i) continue;
+      if (a == 0 && clobbersAcc0) continue;
+      acc = a;
+      break;
     }
+    if (acc < 0) continue;
+    busyUntil[acc] = end;
+
+    // Rename the live range
+    renameDest(&instrs->elems[i], REG_A, def, ACC, acc);
+    for (int j = i+1; j <= end; j++)
+      renameUses(&instrs->elems[j], REG_A, def, ACC, acc);
   }
+
+  delete [] onlyA;
 }
 
 // ============================================================================
@@ -68,20 +166,26 @@ void introduceAccum(CFG* cfg, Liveness* live, Seq<Instr>* instrs)
 void regAlloc(CFG* cfg, Seq<Instr>* instrs)
 {
   // Step 0
-  // Perform liveness analysis
+  // Optimisation pass that introduces accumulators
+  {
+    Liveness accLive;
+    liveness(instrs, cfg, &accLive);
+    introduceAccum(cfg, &accLive, instrs);
+  }
+
+  // Perform liveness analysis on the remaining variables
   Liveness live;
   liveness(instrs, cfg, &live);
 
-  // Optimisation pass that introduces accumulators
-  introduceAccum(cfg, &live, instrs);
-
   // Step 1
   // For each variable, determine a preference for register file A or B.
   int n = getFreshVarCount();
   int* prefA = new int [n];
   int* prefB = new int [n];
+  bool* onlyA = new bool [n];
   UseDef useDefSet;
   for (int i = 0; i < n; i++) prefA[i] = prefB[i] = 0;
+  regFileAOnly(instrs, onlyA);
 
   for (int i = 0; i < instrs->numElems; i++) {
     Instr instr = instrs->elems[i];
@@ -152,6 +256,8 @@ void regAlloc(CFG* cfg, Seq<Instr>* instrs)
       if (neighbour.tag == REG_A) possibleA[neighbour.regId] = false;
       if (neighbour.tag == REG_B) possibleB[neighbour.regId] = false;
     }
+    if (onlyA[i])
+      for (int j = 0; j < NUM_REGS; j++) possibleB[j] = false;
 
     // Find possible register in each register file
     RegId chosenA = -1;
@@ -203,6 +309,7 @@ void regAlloc(CFG* cfg, Seq<Instr>* instrs)
   // Free memory
   delete [] prefA;
   delete [] prefB;
+  delete [] onlyA;
   delete [] liveWith;
 }
 
@@ -0,0 +1,258 @@
+#include "Target/SimplifyCFG.h"
+
+// ============================================================================
+// Simplify control flow
+// ============================================================================
+
+// This pass works on the labelled instruction sequence produced by
+// the translator.  Every branch costs three delay-slot NOPs on the
+// QPU, so the aim is to reduce the number of branches executed.
+
+// Maximum number of instructions in a loop test that may be
+// duplicated by the latch rule below.
+#define MAX_LATCH_SIZE 8
+
+// Compute a mapping from labels to instruction ids.
+
+static InstrId* labelMap(Seq<Instr>* instrs)
+{
+  int numLabels = getFreshLabelCount();
+  InstrId* labels = new InstrId [numLabels];
+  for (int i = 0; i < numLabels; i++)
+    labels[i] = -1;
+  for (int i = 0; i < instrs->numElems; i++)
+    if (instrs->elems[i].tag == LAB)
+      labels[instrs->elems[i].label] = i;
+  return labels;
+}
+
+// Return the index of the first non-label instruction at or after i.
+
+static InstrId skipLabels(Seq<Instr>* instrs, InstrId i)
+{
+  while (i < instrs->numElems && instrs->elems[i].tag == LAB) i++;
+  return i;
+}
+
+// Remove the instructions marked for deletion.
+
+static void removeMarked(Seq<Instr>* instrs, bool* del)
+{
+  int j = 0;
+  for (int i = 0; i < instrs->numElems; i++)
+    if (!del[i]) instrs->elems[j++] = instrs->elems[i];
+  instrs->numElems = j;
+}
+
+// Are two branch conditions the same?
+
+static bool sameBranchCond(BranchCond a, BranchCond b)
+{
+  if (a.tag != b.tag) return false;
+  if (a.tag == COND_ALL || a.tag == COND_ANY) return a.flag == b.flag;
+  return true;
+}
+
+// ============================================================================
+// Jump threading
+// ============================================================================
+
+// A branch to a label whose first instruction is a branch that is
+// certain to be taken is redirected to the final destination.  The
+// second branch is certain to be taken if it is unconditional, or if
+// it has the same condition as the first (branches do not modify the
+// condition flags).
+
+static bool threadJumps(Seq<Instr>* instrs)
+{
+  bool changed = false;
+  InstrId* labels = labelMap(instrs);
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr instr = instrs->elems[i];
+    if (instr.tag != BRL) continue;
+
+    InstrId t = skipLabels(instrs, labels[instr.BRL.label]);
+    if (t >= instrs->numElems) continue;
+    Instr target = instrs->elems[t];
+
+    if (target.tag == BRL && target.BRL.label != instr.BRL.label &&
+        (target.BRL.cond.tag == COND_ALWAYS ||
+         sameBranchCond(target.BRL.cond, instr.BRL.cond))) {
+      instrs->elems[i].BRL.label = target.BRL.label;
+      changed = true;
+    }
+  }
+
+  delete [] labels;
+  return changed;
+}
+
+// ============================================================================
+// Dead branch elimination
+// ============================================================================
+
+// Remove branches that are never taken, branches to a label that
+// would be reached by falling through anyway, and unreachable
+// instructions following an unconditional branch or an 'end'.
+
+static bool removeDeadBranches(Seq<Instr>* instrs)
+{
+  bool changed = false;
+  bool reachable = true;
+  bool* del = new bool [instrs->numElems];
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    Instr instr = instrs->elems[i];
+    del[i] = false;
+
+    if (instr.tag == LAB) { reachable = true; continue; }
+    if (!reachable) { del[i] = changed = true; continue; }
+
+    if (instr.tag == BRL) {
+      bool toNext = false;
+      for (int j = i+1; j < instrs->numElems; j++) {
+        if (instrs->elems[j].tag != LAB) break;
+        if (instrs->elems[j].label == instr.BRL.label) toNext = true;
+      }
+      if (toNext || instr.BRL.cond.tag == COND_NEVER) {
+        del[i] = changed = true;
+        continue;
+      }
+      if (instr.BRL.cond.tag == COND_ALWAYS) reachable = false;
+    }
+
+    if (instr.tag == END) reachable = false;
+  }
+
+  removeMarked(instrs, del);
+  delete [] del;
+  return changed;
+}
+
+// ============================================================================
+// Unused label elimination
+// ============================================================================
+
+// Labels that are not the target of any branch are removed, merging
+// the blocks either side of them.  This gives later passes, such as
+// accumulator allocation, longer straight-line sequences to work on.
+
+static bool removeUnusedLabels(Seq<Instr>* instrs)
+{
+  int numLabels = getFreshLabelCount();
+  bool* used = new bool [numLabels];
+  bool* del = new bool [instrs->numElems];
+  bool changed = false;
+
+  for (int i = 0; i < numLabels; i++) used[i] = false;
+  for (int i = 0; i < instrs->numElems; i++)
+    if (instrs->elems[i].tag == BRL) used[instrs->elems[i].BRL.label] = true;
+
+  for (int i = 0; i < instrs->numElems; i++) {
+    del[i] = instrs->elems[i].tag == LAB && !used[instrs->elems[i].label];
+    changed = changed || del[i];
+  }
+
+  removeMarked(instrs, del);
+  delete [] used;
+  delete [] del;
+  return changed;
+}
+
+// ============================================================================
+// Latch duplication
+// ============================================================================
+
+// An unconditional branch to a loop test (a short straight-line block
+// ending in a conditional backward branch) is replaced by a copy of
+// the test.  This is loop rotation for paths that re-enter the test
+// by a jump, typically the end of a 'then' branch of an 'If' at the
+// bottom of a loop body:
+//
+//   BRL L                            c0; ...; cn
+//   ...                              BRL[cond] S
+//   L: c0; ...; cn          ===>     BRL M
+//   BRL[cond] S                      ...
+//   ...                              L: c0; ...; cn
+//                                    BRL[cond] S
+//                                    M: ...
+//
+// When the loop continues, one branch is executed instead of two.
+// At most one duplication is performed per call.
+
+static bool duplicateLatch(Seq<Instr>* instrs)
+{
+  InstrId* labels = labelMap(instrs);
+  int n = instrs->numElems;
+
+  for (int i = 0; i < n; i++) {
+    Instr instr = instrs->elems[i];
+    if (instr.tag != BRL || instr.BRL.cond.tag != COND_ALWAYS) continue;
+
+    // Find extent of the test
+    InstrId t = skipLabels(instrs, labels[instr.BRL.label]);
+    InstrId k = t;
+    while (k < n && k-t <= MAX_LATCH_SIZE &&
+           (instrs->elems[k].tag == ALU || instrs->elems[k].tag == LI)) k++;
+    if (k >= n || k-t > MAX_LATCH_SIZE) continue;
+
+    // Test must end in a conditional backward branch
+    Instr latch = instrs->elems[k];
+    if (latch.tag != BRL) continue;
+    if (latch.BRL.cond.tag != COND_ANY && latch.BRL.cond.tag != COND_ALL)
+      continue;
+    if (labels[latch.BRL.label] > k) continue;
+
+    // Label for the instruction following the test
+    bool newLabel = !(k+1 < n && instrs->elems[k+1].tag == LAB);
+    Label exit = newLabel ? freshLabel() : instrs->elems[k+1].label;
+
+    Seq<Instr> newInstrs(n + (k-t) + 3);
+    for (int j = 0; j < n; j++) {
+      if (j == i) {
+        for (int c = t; c <= k; c++)
+          newInstrs.append(instrs->elems[c]);
+        Instr br;
+        br.tag          = BRL;
+        br.BRL.cond.tag = COND_ALWAYS;
+        br.BRL.label    = exit;
+        newInstrs.append(br);
+      }
+      else
+        newInstrs.append(instrs->elems[j]);
+
+      if (j == k && newLabel) {
+        Instr lab;
+        lab.tag   = LAB;
+        lab.label = exit;
+        newInstrs.append(lab);
+      }
+    }
+
+    instrs->clear();
+    for (int j = 0; j < newInstrs.numElems; j++)
+      instrs->append(newInstrs.elems[j]);
+
+    delete [] labels;
+    return true;
+  }
+
+  delete [] labels;
+  return false;
+}
+
+// ============================================================================
+// Interface
+// ============================================================================
+
+void simplifyCFG(Seq<Instr>* instrs)
+{
+  bool changed = true;
+  while (changed) {
+    changed = threadJumps(instrs);
+    changed = removeDeadBranches(instrs) || changed;
+    changed = removeUnusedLabels(instrs) || changed;
+    if (!changed) changed = duplicateLatch(instrs);
+  }
+}
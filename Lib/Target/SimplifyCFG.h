@@ -0,0 +1,11 @@
+#ifndef _SIMPLIFYCFG_H_
+#define _SIMPLIFYCFG_H_
+
+#include "Common/Seq.h"
+#include "Target/Syntax.h"
+
+// Remove redundant branches and labels from a labelled instruction
+// sequence, and duplicate short loop tests to save taken branches.
+void simplifyCFG(Seq<Instr>* instrs);
+
+#endif
@@ -40,6 +40,10 @@ enum SubWord {
   , A32    // Bits 31..0
 };
 
+// Sub-word k of the 8-bit or 16-bit sub-words of a word
+inline SubWord subWord(int bits, int k)
+  { return (SubWord) (bits == 8 ? A8 + k : A16 + k); }
+
 // ============================================================================
 // Registers
 // ============================================================================
@@ -78,6 +82,10 @@ enum Special {
   , SPECIAL_VPM_WRITE
   , SPECIAL_HOST_INT
   , SPECIAL_TMU0_S
+  , SPECIAL_SFU_RECIP
+  , SPECIAL_SFU_RECIPSQRT
+  , SPECIAL_SFU_EXP
+  , SPECIAL_SFU_LOG
 };
 
 struct Reg {
@@ -218,6 +226,9 @@ enum ALUOp {
   , A_CLZ          // Count leading zeros
   , A_V8ADDS       // Add with saturation per 8-bit element
   , A_V8SUBS       // Subtract with saturation per 8-bit element
+  , A_UNPACK       // Move of an unpacked sub-word (intermediate op-code)
+  , A_FUNPACK      // Move of an unpacked half float (intermediate op-code)
+  , A_PACK         // Move into a sub-word (intermediate op-code)
 
   // Opcodes for the 'mul' ALU
   , M_FMUL        // Floating-point multiply
@@ -231,6 +242,16 @@ enum ALUOp {
 
 };
 
+// The sub-word operations are moves using the unpack and pack modes
+// of register file A.  'A_UNPACK' and 'A_FUNPACK' read a sub-word of
+// 'srcA', which must be in register file A, zero-extending bytes,
+// sign-extending half-words and converting half floats to floats.
+// 'A_PACK' writes the low bits of 'srcA' to a sub-word of 'dest',
+// which must be in register file A, leaving the rest of it unchanged.
+
+inline bool isSubWordOp(ALUOp op)
+  { return op == A_UNPACK || op == A_FUNPACK || op == A_PACK; }
+
 inline bool isMulOp(ALUOp op)
 {
   return op == M_FMUL   || op == M_MUL24 || op == M_V8MUL  ||
@@ -349,9 +370,10 @@ struct Instr {
     // Load immediate
     struct { bool setFlags; AssignCond cond; Reg dest; Imm imm; } LI;
 
-    // ALU operation
+    // ALU operation, with the sub-word of a sub-word operation
     struct { bool setFlags; AssignCond cond; Reg dest;
-             RegOrImm srcA; ALUOp op; RegOrImm srcB; } ALU;
+             RegOrImm srcA; ALUOp op; RegOrImm srcB;
+             SubWord subWord; } ALU;
 
     // Conditional branch (to target)
     struct { BranchCond cond; BranchTarget target; } BR;
@@ -4,45 +4,46 @@
 #include "VideoCore/Mailbox.h"
 #include "VideoCore/VideoCore.h"
 
-#define QPU_TIMEOUT 10000
-
 void invoke(
   int numQPUs,
   SharedArray<uint32_t> &codeMem,
-  int qpuCodeMemOffset,
-  Seq<int32_t>* params)
+  SharedArray<uint32_t> &paramMem,
+  Seq<int32_t>* params,
+  unsigned timeout)
 {
   // Open mailbox for talking to VideoCore
   int mb = getMailbox();
 
-  // Number of 32-bit words needed for kernel code & parameters
-  int numWords = qpuCodeMemOffset + (params->numElems+2)*numQPUs + 2*numQPUs;
-  assert(numWords < codeMem.size);
+  // Number of 32-bit words needed for parameters
+  int numWords = (params->numElems+2)*numQPUs + 2*numQPUs;
+  assert(numWords <= paramMem.size);
 
-  // Pointer to start of code
-  uint32_t* qpuCodePtr = codeMem.getPointer();
+  // Pointers to start of code and parameters
+  uint32_t* qpuCodePtr  = codeMem.getPointer();
+  uint32_t* qpuParamPtr = paramMem.getPointer();
 
-  // Copy parameters to instruction memory
-  int offset = qpuCodeMemOffset;
+  // Copy parameters to parameter memory
+  int offset = 0;
   uint32_t** paramsPtr = new uint32_t* [numQPUs];
   for (int i = 0; i < numQPUs; i++) {
-    paramsPtr[i] = qpuCodePtr + offset;
-    codeMem[offset++] = (uint32_t) i; // Unique QPU ID
-    codeMem[offset++] = (uint32_t) numQPUs; // QPU count
+    paramsPtr[i] = qpuParamPtr + offset;
+    paramMem[offset++] = (uint32_t) i; // Unique QPU ID
+    paramMem[offset++] = (uint32_t) numQPUs; // QPU count
     for (int j = 0; j < params->numElems; j++)
-      codeMem[offset++] = params->elems[j];
+      paramMem[offset++] = params->elems[j];
   }
 
   // Copy launch messages
-  uint32_t* launchMsgsPtr = qpuCodePtr + offset;
+  uint32_t* launchMsgsPtr = qpuParamPtr + offset;
   for (int i = 0; i < numQPUs; i++) {
-    codeMem[offset++] = (uint32_t) paramsPtr[i];
-    codeMem[offset++] = (uint32_t) qpuCodePtr;
+    paramMem[offset++] = (uint32_t) paramsPtr[i];
+    paramMem[offset++] = (uint32_t) qpuCodePtr;
   }
+  delete [] paramsPtr;
 
   // Launch QPUs
   unsigned result = 
-    execute_qpu(mb, numQPUs, (uint32_t) launchMsgsPtr, 1, QPU_TIMEOUT);
+    execute_qpu(mb, numQPUs, (uint32_t) launchMsgsPtr, 1, timeout);
 
   if (result != 0) {
     printf("Failed to invoke kernel on QPUs\n");
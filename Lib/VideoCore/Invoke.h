@@ -7,11 +7,17 @@
 #include "VideoCore/SharedArray.h"
 #include <stdint.h>
 
+// Time allowed for a kernel to run, in milliseconds, and for one
+// started in the background to serve a work queue
+#define QPU_TIMEOUT            10000
+#define QPU_PERSISTENT_TIMEOUT 0x7fffffff
+
 void invoke(
   int numQPUs,
   SharedArray<uint32_t> &codeMem,
-  int qpuCodeMemOffset,
-  Seq<int32_t>* params);
+  SharedArray<uint32_t> &paramMem,
+  Seq<int32_t>* params,
+  unsigned timeout = QPU_TIMEOUT);
 
 #endif
 #endif
@@ -0,0 +1,103 @@
+#ifndef _RINGBUFFER_H_
+#define _RINGBUFFER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "VideoCore/SharedArray.h"
+
+// ============================================================================
+// Ring buffer
+// ============================================================================
+
+// A single-producer, single-consumer queue of vectors of 16 elements
+// of type 'T' (int or float) for streaming between the ARM and a
+// running kernel (see 'Kernel::start').  Either side may produce,
+// using 'push', with the other consuming, using 'pop'.  On the QPUs,
+// only one QPU may push to, or pop from, a given ring.  No locks are
+// needed, as the head is written only by the producer and the tail
+// only by the consumer, and the memory bypasses the VideoCore's L2
+// cache so that each side sees the other's writes.
+//
+// Layout in words:
+//
+//   0       head: number of vectors pushed
+//   1       capacity minus one (the capacity being a power of two)
+//   16      tail: number of vectors popped
+//   32+16*i slot i
+
+template <typename T> class RingBuffer {
+ private:
+  // Disallow assignment & copying
+  void operator=(RingBuffer<T>& r);
+  RingBuffer(const RingBuffer<T>& r);
+
+  int capacity;
+  SharedArray<int> mem;
+
+  // Access words shared with the QPUs
+  int get(int i) {
+    return __atomic_load_n(&mem[i], __ATOMIC_SEQ_CST);
+  }
+  void set(int i, int x) {
+    __atomic_store_n(&mem[i], x, __ATOMIC_SEQ_CST);
+  }
+
+ public:
+  // Constructor, for a ring of n vectors
+  RingBuffer(int n) : mem(32 + 16*n, GPU_MEM_DIRECT) {
+    assert(sizeof(T) == 4);
+    if (n <= 0 || (n & (n-1)) != 0) {
+      printf("QPULib: ring buffer capacity must be a power of two\n");
+      exit(EXIT_FAILURE);
+    }
+    capacity = n;
+    for (int i = 0; i < 32; i++) set(i, 0);
+    set(1, n-1);
+  }
+
+  uint32_t getAddress() {
+    return mem.getAddress();
+  }
+
+  // Push the 16 elements at x, if there is space
+  bool tryPush(const T* x) {
+    int head = get(0);
+    if (head - get(16) == capacity) return false;
+    int slot = 32 + 16*(head & (capacity-1));
+    for (int i = 0; i < 16; i++) {
+      int bits;
+      memcpy(&bits, &x[i], 4);
+      set(slot+i, bits);
+    }
+    set(0, head+1);
+    return true;
+  }
+
+  // Pop 16 elements into x, if there are any
+  bool tryPop(T* x) {
+    int tail = get(16);
+    if (get(0) == tail) return false;
+    int slot = 32 + 16*(tail & (capacity-1));
+    for (int i = 0; i < 16; i++) {
+      int bits = get(slot+i);
+      memcpy(&x[i], &bits, 4);
+    }
+    set(16, tail+1);
+    return true;
+  }
+
+  // Push, waiting for space
+  void push(const T* x) {
+    while (!tryPush(x)) ;
+  }
+
+  // Pop, waiting for a vector
+  void pop(T* x) {
+    while (!tryPop(x)) ;
+  }
+};
+
+#endif
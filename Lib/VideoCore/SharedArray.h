@@ -7,6 +7,12 @@
 #include "VideoCore/Mailbox.h"
 #include "VideoCore/VideoCore.h"
 
+// Allocation flags for memory that bypasses the VideoCore's L2 cache,
+// so that the ARM and the QPUs see each other's writes while a kernel
+// is running.  Ignored in emulation mode.
+
+#define GPU_MEM_DIRECT 0x4
+
 #ifdef EMULATION_MODE
 
 // ============================================================================
@@ -31,17 +37,19 @@ template <typename T> class SharedArray {
 
   // Allocation
   void alloc(uint32_t n) {
+    // Elements narrower than a word are packed, as on the VideoCore
+    uint32_t words = sizeof(T) < 4 ? (uint32_t) ((n*sizeof(T)+3)/4) : n;
     if (emuHeap == NULL) {
       emuHeapEnd = 0;
       emuHeap = new int32_t [EMULATOR_HEAP_SIZE];
     }
-    if (emuHeapEnd+n >= EMULATOR_HEAP_SIZE) {
+    if (emuHeapEnd+words >= EMULATOR_HEAP_SIZE) {
       printf("QPULib: heap overflow (increase EMULATOR_HEAP_SIZE)\n");
       abort();
     }
     else {
       address = emuHeapEnd;
-      emuHeapEnd += n;
+      emuHeapEnd += words;
       size = n;
     }
   }
@@ -51,6 +59,11 @@ template <typename T> class SharedArray {
     alloc(n);
   }
 
+  // Constructor, with allocation flags
+  SharedArray(uint32_t n, uint32_t flags) {
+    alloc(n);
+  }
+
   uint32_t getAddress() {
     return address*4;
   }
@@ -64,6 +77,13 @@ template <typename T> class SharedArray {
 
   // Subscript
   T& operator[] (int i) {
+    if (sizeof(T) < 4) {
+      if (address+(i*sizeof(T))/4 >= EMULATOR_HEAP_SIZE) {
+        printf("QPULib: accessing off end of heap\n");
+        exit(EXIT_FAILURE);
+      }
+      return ((T*) &emuHeap[address])[i];
+    }
     if (address+i >= EMULATOR_HEAP_SIZE) {
       printf("QPULib: accessing off end of heap\n");
       exit(EXIT_FAILURE);
@@ -97,12 +117,12 @@ template <typename T> class SharedArray {
   uint32_t size;
 
   /* Allocate GPU memory and map it into ARM address space */
-  void alloc(uint32_t n) {
+  void alloc(uint32_t n, uint32_t flags = GPU_MEM_FLG) {
     // Mailbox, for talking to VideoCore
     int mb = getMailbox();
 
     // Allocate memory
-    handle = mem_alloc(mb, n*4, 4096, GPU_MEM_FLG);
+    handle = mem_alloc(mb, n*4, 4096, flags);
     if (!handle) {
       fprintf(stderr, "Failed to allocate GPU memory.");
       exit(EXIT_FAILURE);
@@ -124,6 +144,12 @@ template <typename T> class SharedArray {
     alloc(n);
   }  
 
+  // Constructor, with allocation flags
+  SharedArray(uint32_t n, uint32_t flags) {
+    size = handle = 0;
+    alloc(n, flags);
+  }
+
   uint32_t getAddress() {
     return (uint32_t) gpu_base;
   }
@@ -150,6 +176,7 @@ template <typename T> class SharedArray {
 
   // Subscript
   inline T& operator[] (int i) {
+    if (sizeof(T) < 4) return ((T*) arm_base)[i];
     uint32_t* base = (uint32_t*) arm_base;
     return (T&) base[i];
   }
@@ -0,0 +1,94 @@
+#ifndef _WORKQUEUE_H_
+#define _WORKQUEUE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "VideoCore/SharedArray.h"
+
+// ============================================================================
+// Work queue
+// ============================================================================
+
+// A ring of work descriptors through which the host feeds a kernel
+// that stays running (see 'Persistent' in 'Source/Stmt.h' and
+// 'Kernel::start').  A descriptor is a vector of 15 words, and the
+// host polls for its completion.
+//
+// Layout in words:
+//
+//   0       number of descriptors submitted (written by host)
+//   1       non-zero when the host has asked the kernel to stop
+//   2       capacity minus one (the capacity being a power of two)
+//   16      number of descriptors claimed by the QPUs
+//   32+16*i slot i: 15 words of descriptor then a status word, which
+//           is the descriptor's ticket until processed, and -1 after
+
+class WorkQueue {
+ private:
+  // Disallow assignment & copying
+  void operator=(WorkQueue& q);
+  WorkQueue(const WorkQueue& q);
+
+  int capacity;
+  int submitted;
+  SharedArray<int> mem;
+
+  // Access words shared with the QPUs
+  int get(int i) {
+    return __atomic_load_n(&mem[i], __ATOMIC_SEQ_CST);
+  }
+  void set(int i, int x) {
+    __atomic_store_n(&mem[i], x, __ATOMIC_SEQ_CST);
+  }
+
+ public:
+  // Constructor, for a queue of up to n outstanding descriptors
+  WorkQueue(int n) : mem(32 + 16*n, GPU_MEM_DIRECT) {
+    if (n <= 0 || (n & (n-1)) != 0) {
+      printf("QPULib: work queue capacity must be a power of two\n");
+      exit(EXIT_FAILURE);
+    }
+    capacity  = n;
+    submitted = 0;
+    for (int i = 0; i < 32; i++) set(i, 0);
+    set(2, n-1);
+    for (int i = 0; i < n; i++) set(32 + 16*i + 15, -1);
+  }
+
+  uint32_t getAddress() {
+    return mem.getAddress();
+  }
+
+  // Submit the first n (at most 15) words of a descriptor, waiting
+  // for its slot to be free, and return its ticket
+  int submit(const int* desc, int n = 15) {
+    assert(n >= 0 && n <= 15);
+    int ticket = submitted++;
+    int slot   = 32 + 16*(ticket & (capacity-1));
+    while (get(slot+15) != -1) ;
+    for (int i = 0; i < 15; i++) set(slot+i, i < n ? desc[i] : 0);
+    set(slot+15, ticket);
+    set(0, submitted);
+    return ticket;
+  }
+
+  // Has the descriptor with the given ticket been processed?
+  bool done(int ticket) {
+    assert(ticket >= 0 && ticket < submitted);
+    return get(32 + 16*(ticket & (capacity-1)) + 15) != ticket;
+  }
+
+  // Wait for the descriptor with the given ticket to be processed
+  void wait(int ticket) {
+    while (!done(ticket)) ;
+  }
+
+  // Ask the kernel to finish once the submitted work is done
+  void stop() {
+    set(1, 1);
+  }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// A chain of short-lived temporaries, of the kind placed in the
+// accumulators r0-r3, mixed with values that live across a loop, a
+// rotate (whose amount is held in r5) and a gather (whose result
+// arrives in r4).
+
+const int ROWS = 8;
+
+void chain(Ptr<Int> in, Ptr<Int> out)
+{
+  Int total = 0;
+  For (Int r = 0, r < ROWS, r++)
+    Int x = in[16*r];
+    Int a = x * 3 + 1;
+    Int b = a ^ (x >> 2);
+    Int c = rotate(b, 1) + a;
+    gather(in + 16*r + index());
+    Int d = (c & 255) - (b | 7);
+    Int y;
+    receive(y);
+    Int e = min(d, a) + max(c, y);
+    total = total + (e << 1) - rotate(d, 15);
+    out[16*r] = e + d + d;
+  End
+  out[16*ROWS] = total;
+}
+
+// Rotate a row of 16 values, as 'rotate' does
+void rotateRow(int* v, int n, int* w)
+{
+  for (int i = 0; i < 16; i++) w[(i+n) % 16] = v[i];
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(chain);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16*ROWS), out(16*(ROWS+1));
+  for (int i = 0; i < 16*ROWS; i++) in[i] = (i * 37) % 101;
+
+  // Reference result
+  int ref[16*(ROWS+1)], total[16];
+  for (int i = 0; i < 16; i++) total[i] = 0;
+  for (int r = 0; r < ROWS; r++) {
+    int x[16], a[16], b[16], c[16], d[16], rb[16], rd[16];
+    for (int i = 0; i < 16; i++) {
+      x[i] = in[16*r + i];
+      a[i] = x[i] * 3 + 1;
+      b[i] = a[i] ^ (x[i] >> 2);
+    }
+    rotateRow(b, 1, rb);
+    for (int i = 0; i < 16; i++) {
+      c[i] = rb[i] + a[i];
+      d[i] = (c[i] & 255) - (b[i] | 7);
+    }
+    rotateRow(d, 15, rd);
+    for (int i = 0; i < 16; i++) {
+      int e = (d[i] < a[i] ? d[i] : a[i]) + (c[i] > x[i] ? c[i] : x[i]);
+      total[i] = total[i] + (e << 1) - rd[i];
+      ref[16*r + i] = e + d[i] + d[i];
+    }
+  }
+  for (int i = 0; i < 16; i++) ref[16*ROWS + i] = total[i];
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 16*(ROWS+1); i++) out[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &out);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &out);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < 16*(ROWS+1); i++)
+      if (out[i] != ref[i]) errors++;
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
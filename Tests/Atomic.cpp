@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The QPUs update shared accumulators with atomic adds, minimums and
+// maximums, delayed by differing amounts to shuffle their updates.
+// Each QPU also takes tickets from a shared count, which must all be
+// different.
+
+const int NUM_QPUS = 4;
+const int ROUNDS   = 10;
+
+void update(Ptr<Int> acc, Ptr<Float> facc, Ptr<Int> mn, Ptr<Int> mx,
+            Ptr<Int> count, Ptr<Int> seen)
+{
+  For (Int r = 0, r < ROUNDS, r++)
+    Int delay = (r * 5 + me() * 3) & 7;
+    For (Int d = 0, d < delay, d++) End
+    atomicAdd(acc + 16*(r & 1), index() + me());
+    atomicAdd(facc, toFloat(me()) * 0.5f);
+    Int v = ((r * 7 + me() * 3) & 15) + index();
+    atomicMin(mn, v);
+    atomicMax(mx, v);
+    Int ticket = atomicAdd(count, 1);
+    seen[16*ticket] = me() + 1;
+  End
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(update);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Reference results
+  int acc[32], mn[16], mx[16];
+  float facc = 0;
+  for (int i = 0; i < 32; i++) acc[i] = 0;
+  for (int i = 0; i < 16; i++) { mn[i] = 1000; mx[i] = -1000; }
+  for (int q = 0; q < NUM_QPUS; q++)
+    for (int r = 0; r < ROUNDS; r++) {
+      facc += (float) q * 0.5f;
+      for (int i = 0; i < 16; i++) {
+        acc[16*(r & 1) + i] += i + q;
+        int v = ((r * 7 + q * 3) & 15) + i;
+        if (v < mn[i]) mn[i] = v;
+        if (v > mx[i]) mx[i] = v;
+      }
+    }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  SharedArray<int> accG(32), mnG(16), mxG(16), count(16);
+  SharedArray<int> seen(16*NUM_QPUS*ROUNDS);
+  SharedArray<float> faccG(16);
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 32; i++) accG[i] = 0;
+    for (int i = 0; i < 16; i++) {
+      faccG[i] = 0; mnG[i] = 1000; mxG[i] = -1000; count[i] = 0;
+    }
+    for (int i = 0; i < 16*NUM_QPUS*ROUNDS; i++) seen[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&accG, &faccG, &mnG, &mxG, &count, &seen);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&accG, &faccG, &mnG, &mxG, &count, &seen);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < 32; i++)
+      if (accG[i] != acc[i]) errors++;
+    for (int i = 0; i < 16; i++) {
+      if (faccG[i] != facc) errors++;
+      if (mnG[i] != mn[i] || mxG[i] != mx[i]) errors++;
+      if (count[i] != NUM_QPUS*ROUNDS) errors++;
+    }
+    for (int t = 0; t < NUM_QPUS*ROUNDS; t++)
+      if (seen[16*t] == 0) errors++;
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -17,14 +17,20 @@ GenOptions basicGenOpts()
   opts.numPtrArgs      = 0;
   opts.numPtr2Args     = 0;
   opts.numIntVars      = 4;
-  opts.numFloatVars    = 0;
+  opts.numFloatVars    = 4;
   opts.loopBound       = 5;
-  opts.genFloat        = false;
+  opts.genFloat        = true;
   opts.genRotate       = false;
+  opts.genSFU          = true;
+  opts.genDiv          = true;
+  opts.genReduce       = true;
+  opts.genChar4        = true;
+  opts.genSelect       = true;
   opts.genDeref        = false;
   opts.genDeref2       = false;
   opts.derefOffsetMask = 0;
   opts.genStrided      = false;
+  opts.genWhereHint    = true;
   return opts;
 }
 
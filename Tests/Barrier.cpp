@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Each QPU repeatedly adds its neighbour's value to its own, using
+// barriers to separate the writes of one step from the reads of the
+// next.  The QPUs are delayed by differing amounts to shuffle their
+// arrival at each barrier.
+
+const int NUM_QPUS = 4;
+const int STEPS    = 20;
+
+void step(Ptr<Int> buf, Ptr<Int> out)
+{
+  Int v = me() + 1;
+  For (Int s = 0, s < STEPS, s++)
+    Int delay = ((numQPUs() - me()) * 13 + s * 7) & 31;
+    For (Int d = 0, d < delay, d++) End
+    buf[me()*16 + index()] = v;
+    barrier();
+    Int next = me() + 1;
+    Where (next == numQPUs()) next = 0; End
+    Int w = buf[next*16 + index()];
+    barrier();
+    v = v + w;
+  End
+  out[me()*16 + index()] = v;
+}
+
+// Count the results differing from the reference
+void check(const char* name, SharedArray<int>& out, int* ref)
+{
+  int errors = 0;
+  for (int i = 0; i < 16*NUM_QPUS; i++)
+    if (out[i] != ref[i/16]) errors++;
+  printf("%s: %d errors\n", name, errors);
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(step);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Reference result
+  int ref[NUM_QPUS];
+  for (int q = 0; q < NUM_QPUS; q++) ref[q] = q+1;
+  for (int s = 0; s < STEPS; s++) {
+    int next[NUM_QPUS];
+    for (int q = 0; q < NUM_QPUS; q++)
+      next[q] = ref[q] + ref[(q+1) % NUM_QPUS];
+    for (int q = 0; q < NUM_QPUS; q++) ref[q] = next[q];
+  }
+
+  // Invoke the kernel on the interpreter and the QPUs
+  SharedArray<int> buf(16*NUM_QPUS), out(16*NUM_QPUS);
+  #ifdef EMULATION_MODE
+  k.interpret(&buf, &out);
+  check("Interpreter", out, ref);
+  #endif
+  k(&buf, &out);
+  check("QPU", out, ref);
+
+  return 0;
+}
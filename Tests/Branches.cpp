@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Control flow of the shapes that branch simplification rewrites:
+// an 'If' at the bottom of a loop (whose jump back to the loop test is
+// replaced by a copy of it), empty 'If' and 'Else' bodies, branches
+// to the next instruction, and nested loops.
+
+void branches(Ptr<Int> in, Ptr<Int> out)
+{
+  Int x = *in;
+  Int acc = 0;
+
+  For (Int i = 0, i < 20, i++)
+    If (any(x > 3*i))
+      acc = acc + i;
+    End
+  End
+
+  Int n = 0;
+  While (any(n < 10))
+    n = n + 1;
+    If (all(x > n))
+      acc = acc + 1;
+    Else
+      acc = acc - x;
+    End
+  End
+
+  If (any(x == 1000))
+  Else
+  End
+  If (any(x == 1000)) End
+
+  For (Int j = 0, j < 4, j++)
+    For (Int k = 0, k < j, k++)
+      Where (x > 10*k)
+        acc = acc + k;
+      End
+    End
+  End
+
+  *out = acc;
+}
+
+// Reference result, for the lanes of x
+void reference(int* x, int* ref)
+{
+  int anyAbove[20], allAbove[11];
+  for (int i = 0; i < 20; i++) {
+    anyAbove[i] = 0;
+    for (int l = 0; l < 16; l++) if (x[l] > 3*i) anyAbove[i] = 1;
+  }
+  for (int n = 1; n <= 10; n++) {
+    allAbove[n] = 1;
+    for (int l = 0; l < 16; l++) if (x[l] <= n) allAbove[n] = 0;
+  }
+  for (int l = 0; l < 16; l++) {
+    int acc = 0;
+    for (int i = 0; i < 20; i++)
+      if (anyAbove[i]) acc += i;
+    for (int n = 1; n <= 10; n++)
+      acc = allAbove[n] ? acc + 1 : acc - x[l];
+    for (int j = 0; j < 4; j++)
+      for (int k = 0; k < j; k++)
+        if (x[l] > 10*k) acc += k;
+    ref[l] = acc;
+  }
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(branches);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16), out(16);
+  int ref[16];
+
+  // Inputs for which the 'If' at the bottom of the second loop takes
+  // the 'then' branch every time, never, and some of the time
+  for (int t = 0; t < 3; t++) {
+    for (int i = 0; i < 16; i++)
+      in[i] = t == 0 ? 20 + 3*i : (t == 1 ? 3*i : 6 + i/4);
+    int x[16];
+    for (int i = 0; i < 16; i++) x[i] = in[i];
+    reference(x, ref);
+
+    // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+    for (int run = 0; run < 2; run++) {
+      for (int i = 0; i < 16; i++) out[i] = 0;
+
+      if (run == 0) {
+        #ifdef EMULATION_MODE
+        k.interpret(&in, &out);
+        #else
+        continue;
+        #endif
+      }
+      else
+        k(&in, &out);
+
+      // Count the results differing from the reference
+      int errors = 0;
+      for (int i = 0; i < 16; i++)
+        if (out[i] != ref[i]) errors++;
+      printf("%s, input %d: %d errors\n", run == 0 ? "Interpreter" : "QPU",
+             t, errors);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Packed 8-bit arithmetic: saturating addition and subtraction,
+// multiplication of fractions of 255, min, max and rotation, on words
+// holding bytes near both ends of the range.
+
+const int N = 64;
+
+void bytes(Ptr<Int> x, Ptr<Int> y, Ptr<Int> r)
+{
+  For (Int i = 0, i < N, i = i + 16)
+    Char4 a = toChar4(x[i]);
+    Char4 b = toChar4(y[i]);
+    r[i]       = toInt(a + b);
+    r[i + N]   = toInt(a - b);
+    r[i + 2*N] = toInt(a * b);
+    r[i + 3*N] = toInt(min(a, b));
+    r[i + 4*N] = toInt(max(a, b));
+    r[i + 5*N] = toInt(rotate(a - b + b, 3));
+  End
+}
+
+// Apply a function to each byte of two words
+int bytewise(int a, int b, int (*f)(int, int))
+{
+  unsigned r = 0;
+  for (int j = 0; j < 32; j += 8) {
+    unsigned z = (unsigned) f((int) ((unsigned) a >> j) & 255,
+                              (int) ((unsigned) b >> j) & 255);
+    r |= z << j;
+  }
+  return (int) r;
+}
+
+int adds(int x, int y) { return x + y > 255 ? 255 : x + y; }
+int subs(int x, int y) { return x - y < 0 ? 0 : x - y; }
+int muls(int x, int y) { return (x*y + 127) / 255; }
+int mins(int x, int y) { return x < y ? x : y; }
+int maxs(int x, int y) { return x > y ? x : y; }
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(bytes);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> x(N), y(N), r(6*N);
+  int edges[8] = { 0, 1, 127, 128, 200, 254, 255, 56 };
+  for (int i = 0; i < N; i++) {
+    unsigned a = 0, b = 0;
+    for (int j = 0; j < 4; j++) {
+      a |= (unsigned) edges[(i + 3*j) % 8] << (8*j);
+      b |= (unsigned) edges[(i/8 + 5*j) % 8] << (8*j);
+    }
+    x[i] = (int) a;
+    y[i] = (int) b;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 6*N; i++) r[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&x, &y, &r);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&x, &y, &r);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < N; i++) {
+      int from = (i & ~15) | ((i - 3) & 15);
+      int rot = bytewise(bytewise(x[from], y[from], subs), y[from], adds);
+      if (r[i] != bytewise(x[i], y[i], adds)) errors++;
+      if (r[i + N] != bytewise(x[i], y[i], subs)) errors++;
+      if (r[i + 2*N] != bytewise(x[i], y[i], muls)) errors++;
+      if (r[i + 3*N] != bytewise(x[i], y[i], mins)) errors++;
+      if (r[i + 4*N] != bytewise(x[i], y[i], maxs)) errors++;
+      if (r[i + 5*N] != rot) errors++;
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Cross-lane operations on integers and floats: broadcast and extract
+// of literal and variable lanes, and permutations reversing a vector,
+// swapping neighbouring pairs and gathering every fifth lane.
+
+const int ROWS = 4;
+const int NUM_PATTERNS = 3;
+const int patterns[NUM_PATTERNS][16] = {
+  { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 },
+  { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+  { 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11 } };
+
+void crossLane(Ptr<Int> in, Ptr<Float> fin, Ptr<Int> out, Ptr<Float> fout)
+{
+  For (Int r = 0, r < ROWS, r++)
+    Int x = in[16*r];
+    Float f = fin[16*r];
+    Int lane = (r * 7 + 2) & 15;
+    out[128*r]       = broadcast(x, lane);
+    out[128*r + 16]  = broadcast(x, 9);
+    out[128*r + 32]  = extract(x, lane);
+    out[128*r + 48]  = extract(x, 13);
+    out[128*r + 64]  = permute(x, patterns[0]);
+    out[128*r + 80]  = permute(x, patterns[1]);
+    out[128*r + 96]  = permute(x, patterns[2]);
+    fout[64*r]       = broadcast(f, lane);
+    fout[64*r + 16]  = extract(f, lane);
+    fout[64*r + 32]  = permute(f, patterns[2]);
+  End
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(crossLane);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16*ROWS), out(128*ROWS);
+  SharedArray<float> fin(16*ROWS), fout(64*ROWS);
+  for (int i = 0; i < 16*ROWS; i++) {
+    in[i]  = (i * 7919) % 1999 - 1000;
+    fin[i] = (float) in[i] * -0.125f;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 128*ROWS; i++) out[i] = 0;
+    for (int i = 0; i < 64*ROWS; i++) fout[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &fin, &out, &fout);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &fin, &out, &fout);
+
+    // Count the results differing from the reference.  Extracted
+    // values are only defined in lane 0.
+    int errors = 0;
+    for (int r = 0; r < ROWS; r++) {
+      int* x = &in[16*r];
+      float* f = &fin[16*r];
+      int lane = (r * 7 + 2) & 15;
+      if (out[128*r + 32] != x[lane]) errors++;
+      if (out[128*r + 48] != x[13]) errors++;
+      if (fout[64*r + 16] != f[lane]) errors++;
+      for (int i = 0; i < 16; i++) {
+        if (out[128*r + i] != x[lane]) errors++;
+        if (out[128*r + 16 + i] != x[9]) errors++;
+        for (int p = 0; p < NUM_PATTERNS; p++)
+          if (out[128*r + 64 + 16*p + i] != x[patterns[p][i]]) errors++;
+        if (fout[64*r + i] != f[lane]) errors++;
+        if (fout[64*r + 32 + i] != f[patterns[2][i]]) errors++;
+      }
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Conditions of the kinds whose flags are reused: chained 'Where'
+// blocks on the same comparison, an 'If' on a comparison just made by
+// a 'Where', and comparisons with zero of a value whose computation
+// already set the flags.  Float comparisons, which are not reused by
+// value, are mixed in.
+
+void flags(Ptr<Int> in, Ptr<Int> out)
+{
+  Int x = *in;
+  Int y = 0;
+
+  Where (x > 5) y = y + 1; End
+  Where (x > 5) y = y + 2; Else y = y - 2; End
+  Where (x > 5) y = y + 4; End
+  If (any(x > 5)) y = y + 100; End
+
+  Int m = x & 3;
+  Where (m == 0) y = y + 10; End
+  Where (m != 0) y = y - 1; End
+  Where (m == 0 && x < 9) y = y + 1000; End
+
+  Float f = toFloat(x);
+  Where (f > 2.5f) y = y + 20; End
+  Where (f > 2.5f) y = y + 40; End
+
+  Int n = x - 7;
+  Where (n < 0) y = y ^ 1; End
+  Where (n >= 0) y = y ^ 2; End
+
+  *out = y;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(flags);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16), out(16);
+  for (int i = 0; i < 16; i++) in[i] = i - 3;
+
+  // Reference result
+  int ref[16], anyAbove = 0;
+  for (int i = 0; i < 16; i++) if (in[i] > 5) anyAbove = 1;
+  for (int i = 0; i < 16; i++) {
+    int x = in[i], y = 0;
+    if (x > 5) y += 1;
+    y = x > 5 ? y + 2 : y - 2;
+    if (x > 5) y += 4;
+    if (anyAbove) y += 100;
+    int m = x & 3;
+    if (m == 0) y += 10;
+    if (m != 0) y -= 1;
+    if (m == 0 && x < 9) y += 1000;
+    if ((float) x > 2.5f) y += 20;
+    if ((float) x > 2.5f) y += 40;
+    int n = x - 7;
+    if (n < 0) y ^= 1;
+    if (n >= 0) y ^= 2;
+    ref[i] = y;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 16; i++) out[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &out);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &out);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < 16; i++)
+      if (out[i] != ref[i]) errors++;
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
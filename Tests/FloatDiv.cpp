@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "QPULib.h"
+
+// Division and square root in each precision, compared with the IEEE
+// results.  Approx allows the error of the SFU estimate, and Refined
+// and Precise a couple of units in the last place.  Square roots of
+// zero, -0 and negative numbers must be exactly 0, -0 and NaN.
+
+const int N = 256;
+const float APPROX_TOLERANCE  = 1.0f / (1 << 20);
+const float REFINED_TOLERANCE = 1.0f / (1 << 22);
+
+void divSqrt(Int n, Ptr<Float> a, Ptr<Float> b, Ptr<Float> r)
+{
+  For (Int i = 0, i < n, i = i + 16)
+    Float x = a[i];
+    Float y = b[i];
+    r[i]       = div(x, y, Approx);
+    r[i + n]   = x / y;
+    r[i + 2*n] = div(x, y, Precise);
+    r[i + 3*n] = sqrt(y, Approx);
+    r[i + 4*n] = sqrt(y);
+    r[i + 5*n] = sqrt(y, Precise);
+  End
+}
+
+// Count a result differing from the expected one by more than the
+// relative tolerance, or not matching a special expected value
+int check(float got, float expected, float tolerance)
+{
+  if (isnan(expected)) return isnan(got) ? 0 : 1;
+  if (expected == 0.0f) {
+    uint32_t g, e;
+    memcpy(&g, &got, 4);
+    memcpy(&e, &expected, 4);
+    return g == e ? 0 : 1;
+  }
+  return fabsf(got - expected) / fabsf(expected) > tolerance ? 1 : 0;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(divSqrt);
+
+  // Allocate and initialise arrays shared between ARM and GPU.  The
+  // divisors, which are also the square root operands, span many
+  // orders of magnitude and include negative numbers, zero and -0
+  // (the last two only being used for square roots).
+  SharedArray<float> a(N), b(N), r(6*N);
+  for (int i = 0; i < N; i++) {
+    a[i] = (float) (i % 17 - 8) * 1.37f + 0.01f;
+    b[i] = ldexpf(1.0f + (float) (i % 13) / 13.0f, i % 41 - 20);
+    if (i % 16 == 5) b[i] = -b[i];
+  }
+  b[7] = 0.0f;
+  b[8] = -0.0f;
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 6*N; i++) r[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(N, &a, &b, &r);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(N, &a, &b, &r);
+
+    // Count the results differing from the IEEE ones
+    int errors = 0;
+    for (int i = 0; i < N; i++) {
+      float q = a[i] / b[i], s = sqrtf(b[i]);
+      if (b[i] != 0.0f) {
+        errors += check(r[i], q, APPROX_TOLERANCE);
+        errors += check(r[i + N], q, REFINED_TOLERANCE);
+        errors += check(r[i + 2*N], q, REFINED_TOLERANCE);
+      }
+      errors += check(r[i + 3*N], s, APPROX_TOLERANCE);
+      errors += check(r[i + 4*N], s, REFINED_TOLERANCE);
+      errors += check(r[i + 5*N], s, REFINED_TOLERANCE);
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "QPULib.h"
+
+// Converts every half-precision value to a float, and a set of floats
+// around each rounding boundary to half precision, checking both the
+// interpreter and the compiled code against a host reference.
+
+// Halves converted per kernel call, and floats rounded (four per half)
+const int BATCH = 4096;
+const int NUM_FLOATS = 4*BATCH;
+
+// The interpreter (run 0) is only available when emulating
+#ifdef EMULATION_MODE
+const int FIRST_RUN = 0;
+#else
+const int FIRST_RUN = 1;
+#endif
+
+// ============================================================================
+// Kernel
+// ============================================================================
+
+void halfFloat(Int n, Ptr<Half> p, Ptr<Float> lo, Ptr<Float> hi,
+               Int m, Ptr<Float> x, Ptr<Float> y, Ptr<Half> q)
+{
+  // Widen two halves per word
+  For (Int i = 0, i < n, i = i+16)
+    Half h = p[i];
+    lo[i] = toFloat(h, 0);
+    hi[i] = toFloat(h, 1);
+  End
+
+  // Round two floats per word
+  For (Int i = 0, i < m, i = i+16)
+    q[i] = toHalf(x[i], y[i]);
+  End
+}
+
+// ============================================================================
+// Host reference
+// ============================================================================
+
+uint32_t bitsOf(float f)
+{
+  uint32_t b;
+  memcpy(&b, &f, 4);
+  return b;
+}
+
+float floatOf(uint32_t b)
+{
+  float f;
+  memcpy(&f, &b, 4);
+  return f;
+}
+
+// Widen a half, keeping NaN payloads
+uint32_t widen(uint16_t h)
+{
+  uint32_t sign = (h & 0x8000) << 16;
+  int exp = (h >> 10) & 0x1f;
+  int man = h & 0x3ff;
+  if (exp == 0x1f) return sign | 0x7f800000 | (man << 13);
+  float f = exp == 0 ? ldexpf((float) man, -24)
+                     : ldexpf((float) (1024 + man), exp - 25);
+  return sign | bitsOf(f);
+}
+
+// Round a float to half precision, to nearest even; NaNs become quiet
+// NaNs without payload
+uint16_t narrow(float f)
+{
+  uint16_t sign = (bitsOf(f) >> 16) & 0x8000;
+  float a = fabsf(f);
+  if (isnan(f)) return sign | 0x7e00;
+  if (a >= 65520.0f) return sign | 0x7c00;
+  if (a < ldexpf(1, -14)) return sign | (uint16_t) nearbyintf(ldexpf(a, 24));
+  int e;
+  frexpf(a, &e);
+  e = e - 1;
+  int man = (int) nearbyintf(ldexpf(a, 10 - e));
+  if (man == 2048) { man = 1024; e++; }
+  return (uint16_t) (sign | ((e + 15) << 10) | (man - 1024));
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(halfFloat);
+
+  // Results from the interpreter (0) and the QPUs or emulator (1)
+  SharedArray<uint16_t> halves(BATCH);
+  SharedArray<float> x(NUM_FLOATS/2), y(NUM_FLOATS/2);
+  SharedArray<float> lo0(BATCH/2), hi0(BATCH/2), lo1(BATCH/2), hi1(BATCH/2);
+  SharedArray<uint16_t> q0(NUM_FLOATS), q1(NUM_FLOATS);
+  int widenErrors[2] = { 0, 0 }, roundErrors[2] = { 0, 0 };
+
+  for (int base = 0; base < 65536; base += BATCH) {
+    // Every half, and floats at and either side of the midpoint
+    // between each half and the next one up
+    for (int i = 0; i < BATCH; i++) {
+      int h = base + i;
+      halves[i] = (uint16_t) h;
+      float v = floatOf(widen((uint16_t) h));
+      float mid = v;
+      if ((h & 0x7fff) < 0x7c00) {
+        float next = floatOf(widen((uint16_t) (h + 1)));
+        if ((h & 0x7fff) == 0x7bff) next = copysignf(65536.0f, v);
+        mid = (v + next) / 2;
+      }
+      float in[4] = { v, mid, nextafterf(mid, 0), nextafterf(mid, 2*mid) };
+      for (int j = 0; j < 4; j++) {
+        int n = 4*i + j;
+        if (n & 1) y[n/2] = in[j]; else x[n/2] = in[j];
+      }
+    }
+
+    #ifdef EMULATION_MODE
+    k.interpret(BATCH/2, &halves, &lo0, &hi0, NUM_FLOATS/2, &x, &y, &q0);
+    #endif
+    k(BATCH/2, &halves, &lo1, &hi1, NUM_FLOATS/2, &x, &y, &q1);
+
+    // Check the results
+    for (int r = FIRST_RUN; r < 2; r++) {
+      SharedArray<float>& lo = r == 0 ? lo0 : lo1;
+      SharedArray<float>& hi = r == 0 ? hi0 : hi1;
+      SharedArray<uint16_t>& q = r == 0 ? q0 : q1;
+      for (int i = 0; i < BATCH; i++) {
+        uint32_t got = bitsOf((i & 1) ? hi[i/2] : lo[i/2]);
+        if (got != widen((uint16_t) (base + i)) && widenErrors[r]++ < 10)
+          printf("widen %04x: got %08x\n", base + i, got);
+      }
+      for (int n = 0; n < NUM_FLOATS; n++) {
+        float f = (n & 1) ? y[n/2] : x[n/2];
+        if (q[n] != narrow(f) && roundErrors[r]++ < 10)
+          printf("round %08x: got %04x, expected %04x\n",
+                 bitsOf(f), q[n], narrow(f));
+      }
+    }
+  }
+
+  for (int r = FIRST_RUN; r < 2; r++)
+    printf("%s: %d widening errors, %d rounding errors\n",
+           r == 0 ? "Interpreter" : "QPU", widenErrors[r], roundErrors[r]);
+
+  return 0;
+}
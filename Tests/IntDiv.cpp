@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <limits.h>
+#include "QPULib.h"
+
+// Integer division and modulo, by literals (compiled to multiplies and
+// shifts) and by variables (compiled to a loop), of dividends and
+// divisors of both signs including INT_MIN and INT_MAX, also inside a
+// 'where' (where the flags it tests must survive the loop).  Results are
+// compared with C, taking INT_MIN / -1 to wrap to INT_MIN.  Division
+// by zero is unspecified, so there the compiled code is only compared
+// with the interpreter.
+
+const int N = 64;
+const int NUM_LITERALS = 10;
+const int literals[NUM_LITERALS] = {
+  1, -1, 2, 3, -7, 10, 16, -16, 641, 1 << 20 };
+
+// The interpreter (run 0) is only available when emulating
+#ifdef EMULATION_MODE
+const int FIRST_RUN = 0;
+#else
+const int FIRST_RUN = 1;
+#endif
+
+void divide(Ptr<Int> x, Ptr<Int> y, Ptr<Int> q, Ptr<Int> r, Ptr<Int> lit,
+            Ptr<Int> w)
+{
+  For (Int i = 0, i < N, i = i + 16)
+    Int a = x[i];
+    Int b = y[i];
+    q[i] = a / b;
+    r[i] = a % b;
+    Int c = 0;
+    Where ((b & 3) == 1) c = min(a / b, a % b); End
+    w[i] = c;
+    lit[i]        = a / 1;
+    lit[i + N]    = a / -1;
+    lit[i + 2*N]  = a / 2;
+    lit[i + 3*N]  = a / 3;
+    lit[i + 4*N]  = a / -7;
+    lit[i + 5*N]  = a / 10;
+    lit[i + 6*N]  = a / 16;
+    lit[i + 7*N]  = a / -16;
+    lit[i + 8*N]  = a / 641;
+    lit[i + 9*N]  = a / (1 << 20);
+    lit[i + 10*N] = a % 3;
+    lit[i + 11*N] = a % -7;
+    lit[i + 12*N] = a % 16;
+    lit[i + 13*N] = a % 641;
+  End
+}
+
+// C division and modulo, with INT_MIN / -1 wrapping
+int quot(int a, int b)
+{
+  return b == -1 ? (int) (0u - (unsigned) a) : a / b;
+}
+
+int rem(int a, int b)
+{
+  return b == -1 ? 0 : a % b;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(divide);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> x(N), y(N), q(N), r(N), lit(14*N), w(N);
+  int special[8] = { INT_MIN, INT_MAX, 0, 1, -1, INT_MIN + 1, 7, -7 };
+  for (int i = 0; i < N; i++) {
+    x[i] = i < 8 ? special[i] : (i * 7919 + 13) * (i % 2 ? 1 : -1) * 977;
+    y[i] = i < 48 ? special[(i * 3) % 8] : (i - 56) * 12345;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  int zeroQ[N], zeroR[N];
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < N; i++) { q[i] = 0; r[i] = 0; }
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&x, &y, &q, &r, &lit, &w);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&x, &y, &q, &r, &lit, &w);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < N; i++) {
+      if (y[i] != 0) {
+        if (q[i] != quot(x[i], y[i])) errors++;
+        if (r[i] != rem(x[i], y[i])) errors++;
+      }
+      int m = 0;
+      if ((y[i] & 3) == 1) {
+        m = quot(x[i], y[i]);
+        if (rem(x[i], y[i]) < m) m = rem(x[i], y[i]);
+      }
+      if (w[i] != m) errors++;
+      else if (run == 0) {
+        zeroQ[i] = q[i];
+        zeroR[i] = r[i];
+      }
+      else if (FIRST_RUN == 0 && (q[i] != zeroQ[i] || r[i] != zeroR[i]))
+        errors++;
+      for (int j = 0; j < NUM_LITERALS; j++)
+        if (lit[i + j*N] != quot(x[i], literals[j])) errors++;
+      if (lit[i + 10*N] != rem(x[i], 3)) errors++;
+      if (lit[i + 11*N] != rem(x[i], -7)) errors++;
+      if (lit[i + 12*N] != rem(x[i], 16)) errors++;
+      if (lit[i + 13*N] != rem(x[i], 641)) errors++;
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The QPUs share out the rows of an array two at a time, taking them
+// from a work counter with 'ParFor'.  Rows take differing times to
+// process.  The kernel is run twice to check that the counter is
+// reset for the next launch.
+
+const int NUM_QPUS = 4;
+const int ROWS     = 37;
+
+void scale(Int n, Ptr<Int> counter, Ptr<Int> in, Ptr<Int> out)
+{
+  ParFor (row, n, counter, 2)
+    For (Int r = row, r < min(row + 2, n), r++)
+      Int delay = (r * 7 + me()) & 15;
+      For (Int d = 0, d < delay, d++) End
+      out[16*r] = in[16*r] * 2 + r;
+    End
+  End
+}
+
+// Count the results differing from the reference, and check that the
+// counter is back to zero
+void check(const char* name, SharedArray<int>& in, SharedArray<int>& out,
+           SharedArray<int>& counter)
+{
+  int errors = 0;
+  for (int i = 0; i < 16*ROWS; i++)
+    if (out[i] != in[i] * 2 + i/16) errors++;
+  if (counter[0] != 0) errors++;
+  printf("%s: %d errors\n", name, errors);
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(scale);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> counter(16), in(16*ROWS), out(16*ROWS);
+  for (int i = 0; i < 16; i++) counter[i] = 0;
+  for (int i = 0; i < 16*ROWS; i++) in[i] = i;
+
+  // Invoke the kernel twice on the interpreter and on the QPUs
+  for (int launch = 0; launch < 2; launch++) {
+    #ifdef EMULATION_MODE
+    for (int i = 0; i < 16*ROWS; i++) out[i] = 0;
+    k.interpret(ROWS, &counter, &in, &out);
+    check("Interpreter", in, out, counter);
+    #endif
+    for (int i = 0; i < 16*ROWS; i++) out[i] = 0;
+    k(ROWS, &counter, &in, &out);
+    check("QPU", in, out, counter);
+  }
+
+  return 0;
+}
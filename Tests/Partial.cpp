@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The QPUs scale arrays whose length is not a multiple of 16, using
+// partial loads and stores for the last vector so that nothing beyond
+// the arrays is touched.  Guard words placed after the outputs must
+// survive, and the lanes of a partial load beyond its count must be
+// zero.
+
+const int NUM_QPUS = 4;
+const int N        = 53;
+
+void scale(Int n, Ptr<Int> p, Ptr<Int> q, Ptr<Float> f, Ptr<Float> g,
+           Ptr<Int> tail)
+{
+  ParallelFor (i, count, n)
+    store(load(p + i, count) * 2 + 1, q + i, count);
+    store(load(f + i, count) + 0.5f, g + i, count);
+  End
+  If (me() == 0)
+    store(load(p + (n & ~15), n & 15), tail);
+  End
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(scale);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Allocate and initialise arrays shared between ARM and GPU, each
+  // output being followed by guard words
+  SharedArray<int> p(N), q(N), qGuard(16), tail(16);
+  SharedArray<float> f(N), g(N), gGuard(16);
+  for (int i = 0; i < N; i++) { p[i] = i; f[i] = (float) i; }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < N; i++) { q[i] = -1; g[i] = -1; }
+    for (int i = 0; i < 16; i++) { qGuard[i] = -2; gGuard[i] = -2; tail[i] = -1; }
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(N, &p, &q, &f, &g, &tail);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(N, &p, &q, &f, &g, &tail);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < N; i++) {
+      if (q[i] != 2*i + 1) errors++;
+      if (g[i] != (float) i + 0.5f) errors++;
+    }
+    for (int i = 0; i < 16; i++) {
+      if (qGuard[i] != -2 || gGuard[i] != -2) errors++;
+      if (tail[i] != (i < N % 16 ? (N & ~15) + i : 0)) errors++;
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include "QPULib.h"
+#include "Target/Peephole.h"
+
+// Rotates, copies and dependent chains of the kinds the peephole
+// rules rewrite.  Besides checking the results, every rule should
+// have fired while compiling the kernel.
+
+void shuffle(Ptr<Int> in, Ptr<Int> out)
+{
+  Int x = *in;
+  Int y = x;
+  For (Int i = 0, i < 4, i++)
+    Int a = x + i;
+    Int z = y + 1;
+    Int b = rotate(a, 1);
+    Int t = x;
+    x = t + b;
+    Int u = y;
+    y = u;
+    Int p = 0;
+    Where (x > 300) p = x + y; End
+    Int q = p;
+    y = z - rotate(y, 2);
+    y = rotate(y, 1) ^ rotate(x, 3);
+    y = rotate(y, 5) + rotate(z, 2);
+    x = q - y;
+  End
+  *out = x ^ y;
+}
+
+// Rotate a row of 16 values, as 'rotate' does
+void rotateRow(int* v, int n, int* w)
+{
+  for (int i = 0; i < 16; i++) w[(i+n) % 16] = v[i];
+}
+
+int main()
+{
+  // Construct kernel, counting the rewrites made
+  resetPeepholeHits();
+  auto k = compile(shuffle);
+  int unused = 0;
+  for (int r = 0; r < numPeepholeRules(); r++) {
+    printf("%s: %d\n", peepholeRuleName(r), peepholeRuleHits(r));
+    if (peepholeRuleHits(r) == 0) unused++;
+  }
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16), out(16);
+  for (int i = 0; i < 16; i++) in[i] = 100*i + 7;
+
+  // Reference result
+  int x[16], y[16], ref[16];
+  for (int l = 0; l < 16; l++) x[l] = y[l] = in[l];
+  for (int i = 0; i < 4; i++) {
+    int a[16], b[16], z[16], q[16], r1[16], r2[16];
+    for (int l = 0; l < 16; l++) {
+      a[l] = x[l] + i;
+      z[l] = y[l] + 1;
+    }
+    rotateRow(a, 1, b);
+    for (int l = 0; l < 16; l++) {
+      x[l] = x[l] + b[l];
+      q[l] = x[l] > 300 ? x[l] + y[l] : 0;
+    }
+    rotateRow(y, 2, r1);
+    for (int l = 0; l < 16; l++) y[l] = z[l] - r1[l];
+    rotateRow(y, 1, r1);
+    rotateRow(x, 3, r2);
+    for (int l = 0; l < 16; l++) y[l] = r1[l] ^ r2[l];
+    rotateRow(y, 5, r1);
+    rotateRow(z, 2, r2);
+    for (int l = 0; l < 16; l++) {
+      y[l] = r1[l] + r2[l];
+      x[l] = q[l] - y[l];
+    }
+  }
+  for (int l = 0; l < 16; l++) ref[l] = x[l] ^ y[l];
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 16; i++) out[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &out);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &out);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < 16; i++)
+      if (out[i] != ref[i]) errors++;
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+  printf("Rules not fired: %d\n", unused);
+
+  return 0;
+}
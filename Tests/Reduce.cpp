@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Reductions across the lanes of each row of an array, the result
+// being the same in every lane, and of a literal inside a Where.  The
+// floats are exactly representable sums, so the order in which lanes
+// are combined does not matter.
+
+const int ROWS = 6;
+
+void reduce(Ptr<Int> in, Ptr<Float> fin, Ptr<Int> out, Ptr<Float> fout)
+{
+  For (Int r = 0, r < ROWS, r++)
+    Int x = in[16*r];
+    Float f = fin[16*r];
+    out[128*r]      = reduceAdd(x);
+    out[128*r + 16] = reduceMin(x);
+    out[128*r + 32] = reduceMax(x);
+    out[128*r + 48] = reduceAnd(x);
+    out[128*r + 64] = reduceOr(x);
+    Int y = 0;
+    Where ((x & 1) == 1) y = reduceAdd(IntExpr(3)); End
+    out[128*r + 80] = y;
+    fout[64*r]      = reduceAdd(f);
+    fout[64*r + 16] = reduceMin(f);
+    fout[64*r + 32] = reduceMax(f);
+  End
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(reduce);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16*ROWS), out(128*ROWS);
+  SharedArray<float> fin(16*ROWS), fout(64*ROWS);
+  for (int i = 0; i < 16*ROWS; i++) {
+    in[i]  = ((i * 7919) % 2001 - 1000) | (1 << (i % 20));
+    fin[i] = (float) ((i * 131) % 97 - 48) * 0.25f;
+  }
+
+  // Reference result
+  int ref[8*ROWS];
+  float fref[3*ROWS];
+  for (int r = 0; r < ROWS; r++) {
+    int* x = &in[16*r];
+    float* f = &fin[16*r];
+    int sum = 0, mn = x[0], mx = x[0], a = -1, o = 0;
+    float fsum = 0, fmn = f[0], fmx = f[0];
+    for (int i = 0; i < 16; i++) {
+      sum += x[i]; a &= x[i]; o |= x[i];
+      if (x[i] < mn) mn = x[i];
+      if (x[i] > mx) mx = x[i];
+      fsum += f[i];
+      if (f[i] < fmn) fmn = f[i];
+      if (f[i] > fmx) fmx = f[i];
+    }
+    ref[8*r] = sum; ref[8*r+1] = mn; ref[8*r+2] = mx;
+    ref[8*r+3] = a; ref[8*r+4] = o;
+    fref[3*r] = fsum; fref[3*r+1] = fmn; fref[3*r+2] = fmx;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 128*ROWS; i++) out[i] = 0;
+    for (int i = 0; i < 64*ROWS; i++) fout[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &fin, &out, &fout);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &fin, &out, &fout);
+
+    // Count the results differing from the reference, in every lane
+    int errors = 0;
+    for (int r = 0; r < ROWS; r++)
+      for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 5; j++)
+          if (out[128*r + 16*j + i] != ref[8*r + j]) errors++;
+        if (out[128*r + 80 + i] != ((in[16*r + i] & 1) ? 48 : 0)) errors++;
+        for (int j = 0; j < 3; j++)
+          if (fout[64*r + 16*j + i] != fref[3*r + j]) errors++;
+      }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
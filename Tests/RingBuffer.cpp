@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The host streams vectors through a kernel using ring buffers: one
+// QPU turns float vectors into new ones and another does the same for
+// int vectors.  On the QPUs the rings are smaller than the streams, so
+// the host pushes and pops while the kernel runs.  The interpreter
+// cannot run alongside the host, so it is given rings big enough for
+// the whole streams, with the input already pushed.
+
+const int NUM_QPUS = 2;
+const int FRAMES   = 32;
+
+void stream(Ptr<Float> in, Ptr<Float> out, Ptr<Int> iin, Ptr<Int> iout)
+{
+  If (me() == 0)
+    For (Int i = 0, i < FRAMES, i++)
+      Float x = pop(in);
+      push(out, x * 2.0f + 1.0f);
+    End
+  End
+  If (me() == numQPUs() - 1)
+    For (Int i = 0, i < FRAMES, i++)
+      Int y = pop(iin);
+      push(iout, y + i);
+    End
+  End
+}
+
+// Input frames, and the expected output frames
+void input(int frame, float* f, int* a)
+{
+  for (int i = 0; i < 16; i++) {
+    f[i] = (float) (16*frame + i);
+    a[i] = 100*frame + i;
+  }
+}
+
+int errors(int frame, float* g, int* b)
+{
+  int n = 0;
+  for (int i = 0; i < 16; i++) {
+    if (g[i] != (float) (16*frame + i) * 2.0f + 1.0f) n++;
+    if (b[i] != 101*frame + i) n++;
+  }
+  return n;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(stream);
+  k.setNumQPUs(NUM_QPUS);
+
+  float f[16], g[16];
+  int a[16], b[16];
+
+  // Invoke the kernel on the interpreter
+  #ifdef EMULATION_MODE
+  {
+    RingBuffer<float> in(FRAMES), out(FRAMES);
+    RingBuffer<int> iin(FRAMES), iout(FRAMES);
+    for (int r = 0; r < FRAMES; r++) {
+      input(r, f, a);
+      in.push(f);
+      iin.push(a);
+    }
+    k.interpret(&in, &out, &iin, &iout);
+    int n = 0;
+    for (int r = 0; r < FRAMES; r++) {
+      out.pop(g);
+      iout.pop(b);
+      n += errors(r, g, b);
+    }
+    printf("Interpreter: %d errors\n", n);
+  }
+  #endif
+
+  // Invoke the kernel on the QPUs, streaming while it runs
+  RingBuffer<float> in(4), out(2);
+  RingBuffer<int> iin(2), iout(8);
+  k.start(&in, &out, &iin, &iout);
+  float gs[FRAMES][16];
+  int bs[FRAMES][16];
+  int pushed = 0, popped = 0, ipushed = 0, ipopped = 0;
+  while (popped < FRAMES || ipopped < FRAMES) {
+    input(pushed, f, a);
+    if (pushed < FRAMES && in.tryPush(f)) pushed++;
+    input(ipushed, f, a);
+    if (ipushed < FRAMES && iin.tryPush(a)) ipushed++;
+    if (popped < FRAMES && out.tryPop(gs[popped])) popped++;
+    if (ipopped < FRAMES && iout.tryPop(bs[ipopped])) ipopped++;
+  }
+  k.wait();
+  int n = 0;
+  for (int r = 0; r < FRAMES; r++) n += errors(r, gs[r], bs[r]);
+  printf("QPU: %d errors\n", n);
+
+  return 0;
+}
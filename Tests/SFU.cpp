@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <math.h>
+#include "QPULib.h"
+
+// Evaluates recip, rsqrt, exp2 and log2 with the special function
+// unit over a range of inputs, comparing with the C library.  The
+// interpreter and the emulator are exact, while the QPU's estimates
+// are good to around 22 bits, so a small relative error is allowed.
+
+const int N = 256;
+const float TOLERANCE = 1e-5f;
+
+void sfu(Int n, Ptr<Float> x, Ptr<Float> y, Ptr<Float> r)
+{
+  For (Int i = 0, i < n, i = i + 16)
+    Float a = x[i];
+    Float b = y[i];
+    r[i]       = recip(a);
+    r[i + n]   = rsqrt(a);
+    r[i + 2*n] = exp2(b);
+    r[i + 3*n] = log2(a);
+  End
+}
+
+// Relative error of a result
+float relError(float got, float expected)
+{
+  return fabsf(got - expected) / fabsf(expected);
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(sfu);
+
+  // Allocate and initialise arrays shared between ARM and GPU: x is
+  // positive and y ranges over [-10, 10)
+  SharedArray<float> x(N), y(N), r(4*N);
+  for (int i = 0; i < N; i++) {
+    x[i] = 0.1f + (float) i * 0.37f;
+    y[i] = -10.0f + (float) i * (20.0f / N);
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 4*N; i++) r[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(N, &x, &y, &r);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(N, &x, &y, &r);
+
+    // Count the results differing from the C library by more than the
+    // tolerance (log2 near x = 1 by an absolute error)
+    int errors = 0;
+    for (int i = 0; i < N; i++) {
+      float lg = log2f(x[i]);
+      if (relError(r[i], 1.0f / x[i]) > TOLERANCE) errors++;
+      if (relError(r[i + N], 1.0f / sqrtf(x[i])) > TOLERANCE) errors++;
+      if (relError(r[i + 2*N], exp2f(y[i])) > TOLERANCE) errors++;
+      if (fabsf(r[i + 3*N] - lg) > TOLERANCE * fmaxf(fabsf(lg), 1.0f))
+        errors++;
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
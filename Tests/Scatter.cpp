@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The QPUs transpose a 16x16 matrix, loading it a row at a time and
+// scattering each row down a column.  Each row is also scaled and
+// scattered, as floats, to the same row of a second matrix with its
+// elements shuffled by a table of column numbers.
+
+const int NUM_QPUS = 4;
+
+void transpose(Ptr<Int> in, Ptr<Int> out, Ptr<Int> order, Ptr<Float> fout)
+{
+  Int col = *order;
+  For (Int r = me(), r < 16, r = r + numQPUs())
+    Int x = in[16*r];
+    scatter(x, out + index()*16 + r);
+    scatter(toFloat(x) * 0.5f, fout + r*16 + col);
+  End
+  flush();
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(transpose);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(256), out(256), order(16);
+  SharedArray<float> fout(256);
+  for (int i = 0; i < 256; i++) in[i] = 1000 + i;
+  for (int c = 0; c < 16; c++) order[c] = (c * 7 + 3) & 15;
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 256; i++) { out[i] = -1; fout[i] = -1; }
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &out, &order, &fout);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &out, &order, &fout);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int r = 0; r < 16; r++)
+      for (int c = 0; c < 16; c++) {
+        if (out[16*c + r] != in[16*r + c]) errors++;
+        if (fout[16*r + order[c]] != (float) in[16*r + c] * 0.5f) errors++;
+      }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
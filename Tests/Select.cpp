@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Selection between integers and floats under compound conditions,
+// and Bool masks: assigned from comparisons, combined, reassigned
+// inside a Where, and used to drive select, Where and any.
+
+const int N = 64;
+
+void choose(Ptr<Int> in, Ptr<Float> fin, Ptr<Int> out, Ptr<Float> fout)
+{
+  For (Int i = 0, i < N, i = i + 16)
+    Int x = in[i];
+    Float f = fin[i];
+    Bool pos = x > 0;
+    Bool small = f < 2.5f && f > -2.5f;
+    out[i]         = select(x > 3 || x < -3, x + x, 0 - x);
+    out[i + N]     = select(pos && !small, x, 7);
+    fout[i]        = select(small, f * 2.0f, f);
+    fout[i + N]    = select(!pos, f, 1.5f);
+    Where (small)
+      pos = x > 5;
+    End
+    Int y = 0;
+    Where (pos) y = 1; End
+    If (any(pos && small)) y = y + 10; End
+    out[i + 2*N]   = y;
+  End
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(choose);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(N), out(3*N);
+  SharedArray<float> fin(N), fout(2*N);
+  for (int i = 0; i < N; i++) {
+    in[i]  = (i * 37) % 23 - 11;
+    fin[i] = (float) ((i * 13) % 17 - 8) * 0.5f;
+  }
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 3*N; i++) out[i] = 0;
+    for (int i = 0; i < 2*N; i++) fout[i] = 0;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&in, &fin, &out, &fout);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&in, &fin, &out, &fout);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int r = 0; r < N; r += 16) {
+      int anyBoth = 0;
+      for (int i = r; i < r + 16; i++) {
+        bool small = fin[i] < 2.5f && fin[i] > -2.5f;
+        bool pos = small ? in[i] > 5 : in[i] > 0;
+        if (pos && small) anyBoth = 1;
+      }
+      for (int i = r; i < r + 16; i++) {
+        int x = in[i];
+        float f = fin[i];
+        bool small = f < 2.5f && f > -2.5f;
+        bool pos = small ? x > 5 : x > 0;
+        if (out[i] != (x > 3 || x < -3 ? x * 2 : -x)) errors++;
+        if (out[i + N] != (x > 0 && !small ? x : 7)) errors++;
+        if (fout[i] != (small ? f * 2.0f : f)) errors++;
+        if (fout[i + N] != (x <= 0 ? f : 1.5f)) errors++;
+        if (out[i + 2*N] != (pos ? 1 : 0) + (anyBoth ? 10 : 0)) errors++;
+      }
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// The QPUs pass vectors to one another through a 'Shared' array, each
+// reading the vector written by its neighbour.  One QPU then loads a
+// tile of memory into the array, each QPU doubles one vector of it in
+// place, and another QPU stores the tile back to memory.  A float
+// array is loaded and read in the same way.
+
+const int NUM_QPUS = 4;
+
+void exchange(Ptr<Int> p, Ptr<Int> q, Ptr<Float> f, Ptr<Float> g)
+{
+  Shared<Int, 16*NUM_QPUS> s;
+  Shared<Float, 32> t;
+
+  // Pass vectors round the QPUs
+  s.write(me(), index() + 100*me());
+  barrier();
+  Int next = me() + 1;
+  Where (next == numQPUs()) next = 0; End
+  q[16*me()] = s.read(next);
+  barrier();
+
+  // Work on tiles of memory
+  If (me() == 0)
+    s.loadTile(0, p, NUM_QPUS);
+    t.loadTile(0, f, 2);
+  End
+  barrier();
+  s.write(me(), s.read(me()) * 2);
+  Float x = t.read(me() & 1) + 0.5f;
+  barrier();
+  If (me() == 1)
+    s.storeTile(0, q + 16*NUM_QPUS, NUM_QPUS);
+  End
+  g[16*me()] = x;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(exchange);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> p(16*NUM_QPUS), q(32*NUM_QPUS);
+  SharedArray<float> f(32), g(16*NUM_QPUS);
+  for (int i = 0; i < 16*NUM_QPUS; i++) p[i] = 3*i;
+  for (int i = 0; i < 32; i++) f[i] = (float) i;
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 32*NUM_QPUS; i++) q[i] = -1;
+    for (int i = 0; i < 16*NUM_QPUS; i++) g[i] = -1;
+
+    if (run == 0) {
+      #ifdef EMULATION_MODE
+      k.interpret(&p, &q, &f, &g);
+      #else
+      continue;
+      #endif
+    }
+    else
+      k(&p, &q, &f, &g);
+
+    // Count the results differing from the reference
+    int errors = 0;
+    for (int i = 0; i < 16*NUM_QPUS; i++) {
+      int lane = i % 16, qpu = i / 16;
+      if (q[i] != lane + 100*((qpu+1) % NUM_QPUS)) errors++;
+      if (q[16*NUM_QPUS + i] != 2*p[i]) errors++;
+      if (g[i] != f[16*(qpu & 1) + lane] + 0.5f) errors++;
+    }
+    printf("%s: %d errors\n", run == 0 ? "Interpreter" : "QPU", errors);
+  }
+
+  return 0;
+}
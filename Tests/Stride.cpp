@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// Reads and writes columns of a matrix of 16 rows, one element per
+// row, with the stride between rows set at run time or by a literal.
+// A stride of 15 fits in a DMA setup, while for strides of 3000 and
+// 4095 the row pitch is too large for both reads and writes, and each
+// element is transferred separately.  The last write is a partial
+// store of the first 5 elements.
+
+const int NUM_QPUS = 1;
+const int MAX_STRIDE = 4095;
+const int LITERAL_STRIDE = 3000;
+const int COUNT = 5;
+
+// Words spanned by 16 rows at the largest stride
+const int SIZE = 15*(MAX_STRIDE+1) + 16;
+
+void columns(Int stride, Ptr<Int> p)
+{
+  setReadStride(stride);
+  setWriteStride(stride);
+  Int x = *p;
+  *(p+1) = x + 1;
+  Int y = *(p+2);
+  store(y * 2, p+3, COUNT);
+  flush();
+}
+
+void literalColumns(Int stride, Ptr<Int> p)
+{
+  setReadStride(LITERAL_STRIDE);
+  setWriteStride(LITERAL_STRIDE);
+  Int x = *p;
+  *(p+1) = x + 1;
+  Int y = *(p+2);
+  store(y * 2, p+3, COUNT);
+  flush();
+}
+
+// Count the elements differing from the reference
+int check(SharedArray<int>& a, int stride)
+{
+  int pitch = stride + 1, errors = 0;
+  for (int i = 0; i < SIZE; i++) {
+    int row = i / pitch, col = i % pitch, expected = i;
+    if (row < 16 && col == 1) expected = (i-1) + 1;
+    if (row < COUNT && col == 3) expected = 2*(i-1);
+    if (a[i] != expected) errors++;
+  }
+  return errors;
+}
+
+int main()
+{
+  // Construct kernels
+  auto k = compile(columns);
+  auto lit = compile(literalColumns);
+  k.setNumQPUs(NUM_QPUS);
+  lit.setNumQPUs(NUM_QPUS);
+
+  // Invoke each kernel on the interpreter and the QPUs for each stride
+  SharedArray<int> a(SIZE);
+  int strides[3] = { 15, MAX_STRIDE, LITERAL_STRIDE };
+  for (int s = 0; s < 3; s++) {
+    auto& kernel = strides[s] == LITERAL_STRIDE ? lit : k;
+    #ifdef EMULATION_MODE
+    for (int i = 0; i < SIZE; i++) a[i] = i;
+    kernel.interpret(strides[s], &a);
+    printf("Interpreter, stride %d: %d errors\n", strides[s],
+           check(a, strides[s]));
+    #endif
+    for (int i = 0; i < SIZE; i++) a[i] = i;
+    kernel(strides[s], &a);
+    printf("QPU, stride %d: %d errors\n", strides[s], check(a, strides[s]));
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <limits.h>
+#include "QPULib.h"
+
+// Unrolled loops counting up and down, with literal and variable
+// steps and bounds, over ranges whose lengths leave each possible
+// remainder for the epilogue loop, and ranges close to INT_MIN and
+// INT_MAX where the unrolled loop's guard could wrap.  Each loop
+// counts its iterations and sums the low bits of its index, using a
+// variable declared in the body.
+
+void loops(Int a, Int b, Int step, Ptr<Int> out)
+{
+  Int n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+  Int s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  Unroll(4) For (Int i = a, i < b, i = i + 1)
+    Int t = i & 255;
+    n0 = n0 + 1; s0 = s0 + t;
+  End
+  Unroll(3) For (Int i = b, i > a, i = i - step)
+    Int t = i & 255;
+    n1 = n1 + 1; s1 = s1 + t;
+  End
+  Unroll(4) For (Int i = a, i <= b, i = i + step)
+    Int t = i & 255;
+    n2 = n2 + 1; s2 = s2 + t;
+  End
+  Unroll(5) For (Int i = b, i >= a, i = i - 7)
+    Int t = i & 255;
+    n3 = n3 + 1; s3 = s3 + t;
+  End
+  out[0]  = n0; out[16]  = n1; out[32]  = n2; out[48]  = n3;
+  out[64] = s0; out[80] = s1; out[96] = s2; out[112] = s3;
+}
+
+// Reference result, following the loops in 64-bit arithmetic
+void reference(int a, int b, int step, int* ref)
+{
+  for (int j = 0; j < 8; j++) ref[j] = 0;
+  for (long long i = a; i < b; i++) { ref[0]++; ref[4] += (int) (i & 255); }
+  for (long long i = b; i > a; i -= step) { ref[1]++; ref[5] += (int) (i & 255); }
+  for (long long i = a; i <= b; i += step) { ref[2]++; ref[6] += (int) (i & 255); }
+  for (long long i = b; i >= a; i -= 7) { ref[3]++; ref[7] += (int) (i & 255); }
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(loops);
+
+  // Ranges and steps
+  const int NUM_CASES = 14;
+  int cases[NUM_CASES][3] = {
+      { 0, 10, 3 }, { 0, 11, 3 }, { 0, 12, 3 }, { 0, 13, 1 }, { 5, 5, 1 },
+      { 7, 3, 2 }, { -20, 20, 7 }, { INT_MAX - 10, INT_MAX, 2 },
+      { INT_MAX - 10, INT_MAX - 1, 5 }, { INT_MIN, INT_MIN + 10, 3 },
+      { INT_MIN + 3, INT_MIN + 20, 1 }, { INT_MAX - 1, 0, 1 },
+      { 0, INT_MIN + 2, 2 }, { -100, 100, 1 << 29 } };
+
+  // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+  SharedArray<int> out(128);
+  int errors[2] = { 0, 0 };
+  for (int c = 0; c < NUM_CASES; c++) {
+    int ref[8];
+    reference(cases[c][0], cases[c][1], cases[c][2], ref);
+    for (int run = 0; run < 2; run++) {
+      for (int i = 0; i < 128; i++) out[i] = -1;
+
+      if (run == 0) {
+        #ifdef EMULATION_MODE
+        k.interpret(cases[c][0], cases[c][1], cases[c][2], &out);
+        #else
+        continue;
+        #endif
+      }
+      else
+        k(cases[c][0], cases[c][1], cases[c][2], &out);
+
+      // Count the results differing from the reference
+      for (int j = 0; j < 8; j++)
+        if (out[16*j] != ref[j]) errors[run]++;
+    }
+  }
+  #ifdef EMULATION_MODE
+  printf("Interpreter: %d errors\n", errors[0]);
+  #endif
+  printf("QPU: %d errors\n", errors[1]);
+
+  return 0;
+}
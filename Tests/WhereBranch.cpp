@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// 'Where' bodies that are branched over when no lane is active, forced
+// with 'Branchy', suppressed with 'Predicated' or chosen by body size,
+// with 'Else' parts and nesting.  The threshold makes the condition
+// true in no lanes, some lanes and all lanes.
+
+void where(Int t, Ptr<Int> in, Ptr<Int> out)
+{
+  Int x = *in;
+  Int y = 0;
+
+  Where (x > t, Branchy)
+    y = y + x;
+  End
+
+  Where (x > t, Predicated)
+    y = y + 2*x;
+  Else
+    y = y - 1;
+  End
+
+  // Large enough to be branched over without a hint
+  Where (x > t)
+    Int a = x + 1;
+    Int b = a ^ 5;
+    Int c = (b << 2) - a;
+    Int d = (c & 63) + (b | 1);
+    Int e = max(d, c) - min(a, b);
+    y = y + ((e >> 1) ^ (d + 3));
+  Else
+    y = y + 7;
+  End
+
+  Where (x > t, Branchy)
+    Where (x > t + 5, Branchy)
+      y = y + 1000;
+    Else
+      y = y + 500;
+    End
+  End
+
+  *out = y;
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(where);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16), out(16);
+  for (int i = 0; i < 16; i++) in[i] = i;
+
+  // Conditions true in no lanes, some lanes and all lanes
+  int thresholds[3] = { 100, 7, -1 };
+  for (int n = 0; n < 3; n++) {
+    int t = thresholds[n];
+
+    // Reference result
+    int ref[16];
+    for (int i = 0; i < 16; i++) {
+      int x = in[i], y = 0;
+      if (x > t) y += x;
+      y = x > t ? y + 2*x : y - 1;
+      if (x > t) {
+        int a = x + 1, b = a ^ 5, c = (b << 2) - a;
+        int d = (c & 63) + (b | 1);
+        int e = (d > c ? d : c) - (a < b ? a : b);
+        y += (e >> 1) ^ (d + 3);
+      }
+      else
+        y += 7;
+      if (x > t) y += x > t + 5 ? 1000 : 500;
+      ref[i] = y;
+    }
+
+    // Invoke the kernel on the interpreter (run 0) and the QPUs (run 1)
+    for (int run = 0; run < 2; run++) {
+      for (int i = 0; i < 16; i++) out[i] = 0;
+
+      if (run == 0) {
+        #ifdef EMULATION_MODE
+        k.interpret(t, &in, &out);
+        #else
+        continue;
+        #endif
+      }
+      else
+        k(t, &in, &out);
+
+      // Count the results differing from the reference
+      int errors = 0;
+      for (int i = 0; i < 16; i++)
+        if (out[i] != ref[i]) errors++;
+      printf("%s, threshold %d: %d errors\n",
+             run == 0 ? "Interpreter" : "QPU", t, errors);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include "QPULib.h"
+
+// A persistent kernel serves a work queue, each descriptor asking for
+// one row of an array to be scaled.  The kernel is started in the
+// background, fed through a queue smaller than the number of rows, and
+// then stopped.  The interpreter cannot run alongside the host, so it
+// is given a queue holding every descriptor, already stopped.
+
+const int NUM_QPUS = 4;
+const int ROWS     = 64;
+const int CAPACITY = 4;
+
+// Descriptor word 0 is the row and word 1 the multiplier
+void scale(Ptr<Int> queue, Ptr<Int> in, Ptr<Int> out)
+{
+  Persistent (desc, queue)
+    Int row = broadcast(desc, 0);
+    Int m   = broadcast(desc, 1);
+    out[16*row] = in[16*row] * m + row;
+  End
+}
+
+// Count the results differing from the reference
+void check(const char* name, SharedArray<int>& in, SharedArray<int>& out)
+{
+  int errors = 0;
+  for (int i = 0; i < 16*ROWS; i++)
+    if (out[i] != in[i] * (i/16 % 5 + 1) + i/16) errors++;
+  printf("%s: %d errors\n", name, errors);
+}
+
+int main()
+{
+  // Construct kernel
+  auto k = compile(scale);
+  k.setNumQPUs(NUM_QPUS);
+
+  // Allocate and initialise arrays shared between ARM and GPU
+  SharedArray<int> in(16*ROWS), out(16*ROWS);
+  for (int i = 0; i < 16*ROWS; i++) in[i] = i;
+
+  // Invoke the kernel on the interpreter
+  #ifdef EMULATION_MODE
+  for (int i = 0; i < 16*ROWS; i++) out[i] = -1;
+  WorkQueue all(ROWS);
+  for (int r = 0; r < ROWS; r++) {
+    int desc[2] = { r, r % 5 + 1 };
+    all.submit(desc, 2);
+  }
+  all.stop();
+  k.interpret(&all, &in, &out);
+  check("Interpreter", in, out);
+  #endif
+
+  // Invoke the kernel on the QPUs, feeding it while it runs
+  for (int i = 0; i < 16*ROWS; i++) out[i] = -1;
+  WorkQueue queue(CAPACITY);
+  k.start(&queue, &in, &out);
+  for (int r = 0; r < ROWS; r++) {
+    int desc[2] = { r, r % 5 + 1 };
+    queue.submit(desc, 2);
+  }
+  queue.stop();
+  k.wait();
+  check("QPU", in, out);
+
+  return 0;
+}